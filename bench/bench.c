@@ -0,0 +1,421 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "poison.h"
+#include "poison_policy.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_THREADS 256
+#define BENCH_MAX_BASELINE 256
+#define BENCH_NAME_LEN 64
+
+typedef enum
+{
+    BENCH_STEP = 0,
+    BENCH_STEP_OBSERVE,
+    BENCH_OBS_FULL,
+    BENCH_OBS_PARTIAL,
+    BENCH_OBS_U8,
+    BENCH_OBS_BITS,
+    BENCH_OBS_ALL,
+    BENCH_MASK,
+    BENCH_MASK_TYPED,
+    BENCH_RESET,
+    BENCH_NEW_ROUND,
+    BENCH_POLICY_GREEDY,
+    BENCH_POLICY_LOOKAHEAD,
+    BENCH_NUM_OPS
+} BenchOp;
+
+static const char *const BENCH_OP_NAMES[BENCH_NUM_OPS] = {
+    "step", "step_observe", "obs_full", "obs_partial", "obs_u8", "obs_bits", "obs_all", "mask", "mask_typed", "reset",
+    "new_round", "policy_greedy", "policy_lookahead",
+};
+
+typedef struct
+{
+    unsigned threads;
+    unsigned samples;
+    unsigned batch;
+    unsigned warmup;
+    const char *baseline_path;
+    const char *output_path;
+    double max_regression_pct; // < 0 disables the check
+} BenchOptions;
+
+typedef struct
+{
+    BenchOp op;
+    uint8_t num_players;
+    GameVariant variant;
+} BenchCase;
+
+typedef struct
+{
+    const BenchOptions *options;
+    const BenchCase *bench_case;
+    pthread_barrier_t *barrier;
+    unsigned thread_id;
+    double *sample_ns; // mean ns/op over each sample's batch
+} BenchWorker;
+
+typedef struct
+{
+    char name[BENCH_NAME_LEN];
+    double ns_per_op;
+} BaselineEntry;
+
+static double bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static const char *variant_name(GameVariant variant)
+{
+    return variant == GAME_VARIANT_DRAW ? "draw" : "classic";
+}
+
+static void case_name(const BenchCase *bench_case, char *out, size_t out_len)
+{
+    snprintf(out, out_len, "%s/%s/%up", BENCH_OP_NAMES[bench_case->op], variant_name(bench_case->variant),
+             bench_case->num_players);
+}
+
+// step plays a random legal action (sampling included) and rolls over rounds and
+// games inline, as an RL environment loop would
+static void bench_step(GameState *state, GameRng *rng)
+{
+    StepResult result = game_step_action(state, game_sample_legal_action(state, rng));
+    if (result.done)
+        game_reset(state);
+    else if (result.round_done)
+        game_start_new_round(state);
+}
+
+// advances to a mid-round position so observations and masks see realistic tables
+static void bench_mid_round(GameState *state, GameRng *rng)
+{
+    game_reset(state);
+    for (int i = 0; i < 3 * game_get_num_players(state); i++)
+        bench_step(state, rng);
+}
+
+static void bench_run_batch(BenchOp op, GameState *state, GameRng *rng, float *obs, uint8_t *mask,
+                            unsigned count)
+{
+    size_t obs_len = game_observation_size();
+    size_t mask_len = game_action_space_size();
+    uint8_t perspective = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        switch (op)
+        {
+        case BENCH_STEP:
+            bench_step(state, rng);
+            break;
+        case BENCH_STEP_OBSERVE:
+            game_step_observe(state, game_sample_legal_action(state, rng), GAME_STEP_AUTO_ROUND | GAME_STEP_AUTO_RESET,
+                              GAME_OBS_PARTIAL, GAME_OBS_FORMAT_F32, NULL, obs, obs_len * sizeof(float), mask,
+                              mask_len);
+            break;
+        case BENCH_OBS_FULL:
+            game_get_observation(state, perspective, GAME_OBS_FULL, obs, obs_len);
+            perspective = (uint8_t)((perspective + 1) % game_get_num_players(state));
+            break;
+        case BENCH_OBS_PARTIAL:
+            game_get_observation(state, perspective, GAME_OBS_PARTIAL, obs, obs_len);
+            perspective = (uint8_t)((perspective + 1) % game_get_num_players(state));
+            break;
+        case BENCH_OBS_U8:
+        case BENCH_OBS_BITS:
+        {
+            GameObsFormat format = op == BENCH_OBS_U8 ? GAME_OBS_FORMAT_U8 : GAME_OBS_FORMAT_BITS;
+            game_get_observation_encoded(state, perspective, GAME_OBS_PARTIAL, format, obs, obs_len * sizeof(float));
+            perspective = (uint8_t)((perspective + 1) % game_get_num_players(state));
+            break;
+        }
+        case BENCH_OBS_ALL:
+            game_get_observations_all(state, GAME_OBS_PARTIAL, obs, obs_len, obs_len * NUM_PLAYERS_MAX);
+            break;
+        case BENCH_MASK:
+            game_get_legal_action_mask(state, mask, mask_len);
+            break;
+        case BENCH_MASK_TYPED:
+            game_get_typed_legal_action_mask(state, mask, mask_len);
+            break;
+        case BENCH_RESET:
+            game_reset(state);
+            break;
+        case BENCH_NEW_ROUND:
+            // the last round ends the game; a reset every max-rounds calls is part of the cost
+            if (game_is_game_over(state))
+                game_reset(state);
+            game_start_new_round(state);
+            break;
+        case BENCH_POLICY_GREEDY:
+            mask[0] = (uint8_t)policy_act(POLICY_AVOID_OVERFLOW, state, rng);
+            break;
+        case BENCH_POLICY_LOOKAHEAD:
+            mask[0] = (uint8_t)policy_act(POLICY_LOOKAHEAD, state, rng);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void *bench_worker(void *arg)
+{
+    BenchWorker *worker = arg;
+    const BenchOptions *options = worker->options;
+    const BenchCase *bench_case = worker->bench_case;
+    uint64_t seed = game_seed_for(0x9E3779B9u, worker->thread_id, 0);
+    GameRng rng;
+    game_rng_seed(&rng, seed, 1);
+
+    GameState *state = game_init(bench_case->num_players, bench_case->variant, seed);
+    float *obs = malloc(game_observation_size() * NUM_PLAYERS_MAX * sizeof(float));
+    uint8_t *mask = malloc(game_action_space_size());
+    if (!state || !obs || !mask)
+    {
+        fprintf(stderr, "bench: allocation failed\n");
+        exit(1);
+    }
+
+    bench_mid_round(state, &rng);
+    bench_run_batch(bench_case->op, state, &rng, obs, mask, options->warmup);
+
+    pthread_barrier_wait(worker->barrier);
+    for (unsigned s = 0; s < options->samples; s++)
+    {
+        double start = bench_now_ns();
+        bench_run_batch(bench_case->op, state, &rng, obs, mask, options->batch);
+        worker->sample_ns[s] = (bench_now_ns() - start) / options->batch;
+    }
+    pthread_barrier_wait(worker->barrier);
+
+    free(mask);
+    free(obs);
+    game_destroy(state);
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, size_t count, double p)
+{
+    size_t idx = (size_t)(p * (double)(count - 1) + 0.5);
+    return sorted[idx];
+}
+
+static size_t load_baseline(const char *path, BaselineEntry *entries, size_t capacity)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "bench: cannot open baseline %s\n", path);
+        return 0;
+    }
+
+    // one result object per line, as written by this program
+    char line[1024];
+    size_t count = 0;
+    while (count < capacity && fgets(line, sizeof(line), file))
+    {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *ns = strstr(line, "\"ns_per_op\": ");
+        if (!name || !ns)
+            continue;
+
+        BaselineEntry *entry = &entries[count];
+        if (sscanf(name, "\"name\": \"%63[^\"]\"", entry->name) == 1 &&
+            sscanf(ns, "\"ns_per_op\": %lf", &entry->ns_per_op) == 1)
+            count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+static const BaselineEntry *find_baseline(const BaselineEntry *entries, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strcmp(entries[i].name, name) == 0)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--threads N] [--samples N] [--batch N] [--warmup N]\n"
+            "          [--baseline FILE] [--max-regression PCT] [--output FILE]\n",
+            prog);
+}
+
+static bool parse_options(int argc, char **argv, BenchOptions *options)
+{
+    options->threads = 1;
+    options->samples = 50;
+    options->batch = 2000;
+    options->warmup = 2000;
+    options->baseline_path = NULL;
+    options->output_path = NULL;
+    options->max_regression_pct = -1.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value)
+            return false;
+
+        if (strcmp(arg, "--threads") == 0)
+            options->threads = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--samples") == 0)
+            options->samples = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--batch") == 0)
+            options->batch = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--warmup") == 0)
+            options->warmup = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--baseline") == 0)
+            options->baseline_path = value;
+        else if (strcmp(arg, "--max-regression") == 0)
+            options->max_regression_pct = strtod(value, NULL);
+        else if (strcmp(arg, "--output") == 0)
+            options->output_path = value;
+        else
+            return false;
+        i++;
+    }
+
+    return options->threads >= 1 && options->threads <= BENCH_MAX_THREADS && options->samples >= 1 &&
+           options->batch >= 1;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    BaselineEntry baseline[BENCH_MAX_BASELINE];
+    size_t baseline_count = 0;
+    if (options.baseline_path)
+        baseline_count = load_baseline(options.baseline_path, baseline, BENCH_MAX_BASELINE);
+
+    FILE *out = options.output_path ? fopen(options.output_path, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "bench: cannot open %s\n", options.output_path);
+        return 1;
+    }
+
+    size_t total_samples = (size_t)options.threads * options.samples;
+    double *samples = malloc(total_samples * sizeof(double));
+    BenchWorker *workers = malloc(options.threads * sizeof(BenchWorker));
+    pthread_t *threads = malloc(options.threads * sizeof(pthread_t));
+    if (!samples || !workers || !threads)
+    {
+        fprintf(stderr, "bench: allocation failed\n");
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"threads\": %u,\n  \"samples\": %u,\n  \"batch\": %u,\n  \"results\": [\n",
+            options.threads, options.samples, options.batch);
+
+    int regressions = 0;
+    bool first = true;
+    for (int op = 0; op < BENCH_NUM_OPS; op++)
+    {
+        for (int variant = GAME_VARIANT_CLASSIC; variant <= GAME_VARIANT_DRAW; variant++)
+        {
+            for (uint8_t np = NUM_PLAYERS_MIN; np <= NUM_PLAYERS_MAX; np++)
+            {
+                BenchCase bench_case = {(BenchOp)op, np, (GameVariant)variant};
+                pthread_barrier_t barrier;
+                pthread_barrier_init(&barrier, NULL, options.threads);
+
+                for (unsigned t = 0; t < options.threads; t++)
+                {
+                    workers[t].options = &options;
+                    workers[t].bench_case = &bench_case;
+                    workers[t].barrier = &barrier;
+                    workers[t].thread_id = t;
+                    workers[t].sample_ns = samples + (size_t)t * options.samples;
+                    if (pthread_create(&threads[t], NULL, bench_worker, &workers[t]) != 0)
+                    {
+                        // threads already started wait on the barrier for this one
+                        fprintf(stderr, "bench: cannot start thread %u\n", t);
+                        exit(1);
+                    }
+                }
+                for (unsigned t = 0; t < options.threads; t++)
+                    pthread_join(threads[t], NULL);
+                pthread_barrier_destroy(&barrier);
+
+                double sum = 0.0;
+                for (size_t i = 0; i < total_samples; i++)
+                    sum += samples[i];
+                double mean = sum / (double)total_samples;
+                qsort(samples, total_samples, sizeof(double), compare_double);
+
+                char name[BENCH_NAME_LEN];
+                case_name(&bench_case, name, sizeof(name));
+
+                // each thread runs its own copy of the workload, so throughput scales with threads.
+                // Ops are timed a batch at a time, so the spread is over batch means, not single ops.
+                fprintf(out,
+                        "%s    {\"name\": \"%s\", \"op\": \"%s\", \"variant\": \"%s\", \"players\": %u, "
+                        "\"ns_per_op\": %.2f, \"ops_per_sec\": %.0f, \"batch_mean_p50_ns\": %.2f, "
+                        "\"batch_mean_p90_ns\": %.2f, \"batch_mean_p99_ns\": %.2f, \"batch_mean_min_ns\": %.2f, "
+                        "\"batch_mean_max_ns\": %.2f",
+                        first ? "" : ",\n", name, BENCH_OP_NAMES[op], variant_name((GameVariant)variant), np,
+                        mean, 1e9 / mean * options.threads, percentile(samples, total_samples, 0.50),
+                        percentile(samples, total_samples, 0.90), percentile(samples, total_samples, 0.99),
+                        samples[0], samples[total_samples - 1]);
+                first = false;
+
+                const BaselineEntry *base = find_baseline(baseline, baseline_count, name);
+                if (base && base->ns_per_op > 0.0)
+                {
+                    double delta_pct = (mean - base->ns_per_op) / base->ns_per_op * 100.0;
+                    fprintf(out, ", \"baseline_ns_per_op\": %.2f, \"delta_pct\": %.2f", base->ns_per_op,
+                            delta_pct);
+                    if (options.max_regression_pct >= 0.0 && delta_pct > options.max_regression_pct)
+                    {
+                        fprintf(stderr, "bench: %s regressed by %.1f%%\n", name, delta_pct);
+                        regressions++;
+                    }
+                }
+                fprintf(out, "}");
+            }
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+
+    free(threads);
+    free(workers);
+    free(samples);
+    return regressions ? 1 : 0;
+}
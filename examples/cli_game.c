@@ -1,8 +1,23 @@
-#include "poison.h"
+#define _POSIX_C_SOURCE 200809L
 
+#include "poison.h"
+#include "poison_mcts.h"
+#include "poison_plugin.h"
+#include "poison_tournament.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+
+#define SIM_MAX_THREADS 256
+#define AI_ITERATIONS 3000
+#define TOURNAMENT_MAX_ENTRANTS 16
 
 static void clear_input_buffer(void)
 {
@@ -192,7 +207,35 @@ static StepResult play_human_turn(GameState *state, uint8_t player)
     return result;
 }
 
-static StepResult play_ai_turn(GameState *state, uint8_t player)
+static uint16_t choose_ai_action(const GameState *state, uint8_t player, const uint16_t *legal_ids,
+                                 uint16_t legal_count, uint32_t iterations, GameRng *rng)
+{
+    uint16_t action_space = game_action_space_size();
+    float *visits = malloc(action_space * sizeof(*visits));
+    MctsConfig config;
+
+    mcts_config_default(&config);
+    config.iterations = iterations;
+    config.seed = game_rng_next64(rng);
+
+    if (!visits || !mcts_search(state, player, &config, visits, action_space, NULL))
+    {
+        free(visits);
+        return legal_ids[game_rng_bounded(rng, legal_count)];
+    }
+
+    uint16_t best = legal_ids[0];
+    for (uint16_t i = 1; i < legal_count; i++)
+    {
+        if (visits[legal_ids[i]] > visits[best])
+            best = legal_ids[i];
+    }
+
+    free(visits);
+    return best;
+}
+
+static StepResult play_ai_turn(GameState *state, uint8_t player, GameRng *rng)
 {
     StepResult result = {0};
     uint16_t action_space = game_action_space_size();
@@ -223,7 +266,7 @@ static StepResult play_ai_turn(GameState *state, uint8_t player)
         return game_step_action(state, 0);
     }
 
-    uint16_t chosen = legal_ids[rand() % legal_count];
+    uint16_t chosen = choose_ai_action(state, player, legal_ids, legal_count, AI_ITERATIONS, rng);
     uint8_t card_index = (uint8_t)(chosen / NUM_CAULDRONS);
     uint8_t cauldron_index = (uint8_t)(chosen % NUM_CAULDRONS);
     Card card;
@@ -276,9 +319,452 @@ static void show_final_results(GameState *state)
         printf("Tie game.\n");
 }
 
-int main(void)
+// headless self-play: --sim N plays N games with AI on every seat. Game g is
+// dealt from game_seed_for(seed, g, 0) and its moves draw from stream 1 of that
+// seed, so results do not depend on the thread count or scheduling.
+typedef struct
+{
+    uint32_t games;
+    unsigned threads;
+    uint8_t num_players;
+    GameVariant variant;
+    uint64_t seed;
+    uint32_t iterations; // MCTS playouts per move, 0 = uniform random legal moves
+    bool players_given;
+    // --tournament: comma-separated built-in policies, played at every table
+    // size unless --players picks one
+    char *tournament;
+    uint32_t deals;
+    TournamentMode mode;
+} SimOptions;
+
+// pending game indices of one thread as [begin, end) packed into a single word:
+// the owner takes from the front, thieves take the back half, both by CAS
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t range;
+} SimQueue;
+
+typedef struct
+{
+    const SimOptions *options;
+    SimQueue *queues;
+    unsigned thread_id;
+    int32_t *scores; // options->num_players per game, indexed by game
+    uint64_t steps;
+    uint64_t games;
+    uint64_t ties;
+    uint64_t wins[NUM_PLAYERS_MAX];
+} SimWorker;
+
+static uint64_t sim_pack(uint32_t begin, uint32_t end)
+{
+    return (uint64_t)end << 32 | begin;
+}
+
+static bool sim_take(SimQueue *queue, uint32_t *out_game)
+{
+    uint64_t range = atomic_load(&queue->range);
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end)
+            return false;
+        if (atomic_compare_exchange_weak(&queue->range, &range, sim_pack(begin + 1, end)))
+        {
+            *out_game = begin;
+            return true;
+        }
+    }
+}
+
+static bool sim_steal(SimQueue *victim, uint32_t *out_begin, uint32_t *out_end)
+{
+    uint64_t range = atomic_load(&victim->range);
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end)
+            return false;
+        uint32_t split = end - (end - begin + 1) / 2;
+        if (atomic_compare_exchange_weak(&victim->range, &range, sim_pack(begin, split)))
+        {
+            *out_begin = split;
+            *out_end = end;
+            return true;
+        }
+    }
+}
+
+static bool sim_next_game(SimWorker *worker, uint32_t *out_game)
+{
+    if (sim_take(&worker->queues[worker->thread_id], out_game))
+        return true;
+
+    unsigned threads = worker->options->threads;
+    for (unsigned k = 1; k < threads; k++)
+    {
+        uint32_t begin, end;
+        if (!sim_steal(&worker->queues[(worker->thread_id + k) % threads], &begin, &end))
+            continue;
+        // only this thread refills its own queue, and it is empty here
+        atomic_store(&worker->queues[worker->thread_id].range, sim_pack(begin + 1, end));
+        *out_game = begin;
+        return true;
+    }
+    return false;
+}
+
+static uint16_t sim_choose_action(const GameState *state, uint32_t iterations, uint8_t *mask, uint16_t *legal_ids,
+                                  GameRng *rng)
+{
+    if (iterations == 0)
+        return game_sample_legal_action(state, rng);
+
+    uint16_t action_space = game_action_space_size();
+    uint16_t legal_count = 0;
+    game_get_legal_action_mask(state, mask, action_space);
+    for (uint16_t action_id = 0; action_id < action_space; action_id++)
+    {
+        if (mask[action_id])
+            legal_ids[legal_count++] = action_id;
+    }
+    if (legal_count == 0)
+        return 0;
+
+    return choose_ai_action(state, game_get_current_player(state), legal_ids, legal_count, iterations, rng);
+}
+
+static void *sim_worker_main(void *arg)
 {
-    srand((unsigned int)time(NULL));
+    SimWorker *worker = arg;
+    const SimOptions *options = worker->options;
+    uint16_t action_space = game_action_space_size();
+    uint8_t *mask = malloc(action_space * sizeof(*mask));
+    uint16_t *legal_ids = malloc(action_space * sizeof(*legal_ids));
+    GameState *state = game_init(options->num_players, options->variant, options->seed);
+    uint32_t game;
+
+    while (mask && legal_ids && state && sim_next_game(worker, &game))
+    {
+        uint64_t game_seed = game_seed_for(options->seed, game, 0);
+        GameRng rng;
+        game_rng_seed(&rng, game_seed, 1);
+        game_init_into(state, options->num_players, options->variant, game_seed);
+
+        while (!game_is_game_over(state))
+        {
+            StepResult step = game_step_action(state, sim_choose_action(state, options->iterations, mask, legal_ids,
+                                                                        &rng));
+            worker->steps++;
+            if (step.round_done && !step.done)
+                game_start_new_round(state);
+        }
+
+        int8_t winner = game_get_winner(state);
+        if (winner >= 0)
+            worker->wins[winner]++;
+        else
+            worker->ties++;
+        for (uint8_t p = 0; p < options->num_players; p++)
+            worker->scores[(size_t)game * options->num_players + p] = game_get_player_score(state, p);
+        worker->games++;
+    }
+
+    game_destroy(state);
+    free(legal_ids);
+    free(mask);
+    return NULL;
+}
+
+static int compare_int32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double sim_now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void sim_report(const SimOptions *options, const SimWorker *workers, const int32_t *scores, double seconds)
+{
+    uint64_t games = 0, steps = 0, ties = 0;
+    uint64_t wins[NUM_PLAYERS_MAX] = {0};
+    for (unsigned t = 0; t < options->threads; t++)
+    {
+        games += workers[t].games;
+        steps += workers[t].steps;
+        ties += workers[t].ties;
+        for (uint8_t p = 0; p < options->num_players; p++)
+            wins[p] += workers[t].wins[p];
+    }
+
+    printf("Simulated %llu games (%u players, %s, seed %llu, %s) on %u threads\n", (unsigned long long)games,
+           (unsigned)options->num_players, options->variant == GAME_VARIANT_DRAW ? "draw" : "classic",
+           (unsigned long long)options->seed, options->iterations ? "mcts" : "random", options->threads);
+    printf("  %.3f s, %.0f games/s, %.0f steps/s, %.1f steps/game\n", seconds, (double)games / seconds,
+           (double)steps / seconds, games ? (double)steps / (double)games : 0.0);
+    printf("  Ties: %llu (%.2f%%)\n", (unsigned long long)ties, games ? 100.0 * (double)ties / (double)games : 0.0);
+    printf("\n  Seat     Wins    Win%%     Mean   StdDev    Min    P10    P50    P90    Max\n");
+
+    int32_t *column = malloc((games ? games : 1) * sizeof(*column));
+    if (!column)
+        return;
+
+    for (uint8_t p = 0; p < options->num_players; p++)
+    {
+        double sum = 0.0, sum_sq = 0.0;
+        for (uint64_t g = 0; g < games; g++)
+        {
+            column[g] = scores[g * options->num_players + p];
+            sum += column[g];
+            sum_sq += (double)column[g] * column[g];
+        }
+        double mean = games ? sum / (double)games : 0.0;
+        double variance = games ? sum_sq / (double)games - mean * mean : 0.0;
+        qsort(column, games, sizeof(*column), compare_int32);
+
+        printf("  %4u %8llu %7.2f%% %8.2f %8.2f", (unsigned)(p + 1), (unsigned long long)wins[p],
+               games ? 100.0 * (double)wins[p] / (double)games : 0.0, mean, variance > 0.0 ? sqrt(variance) : 0.0);
+        if (games)
+            printf(" %6d %6d %6d %6d %6d\n", (int)column[0], (int)column[games / 10], (int)column[games / 2],
+                   (int)column[games * 9 / 10], (int)column[games - 1]);
+        else
+            printf("\n");
+    }
+    free(column);
+}
+
+static int run_simulation(const SimOptions *options)
+{
+    int32_t *scores = malloc(((size_t)options->games * options->num_players + 1) * sizeof(*scores));
+    SimQueue *queues = aligned_alloc(64, options->threads * sizeof(SimQueue));
+    SimWorker *workers = calloc(options->threads, sizeof(*workers));
+    pthread_t *threads = malloc(options->threads * sizeof(*threads));
+    if (!scores || !queues || !workers || !threads)
+    {
+        fprintf(stderr, "sim: allocation failed\n");
+        free(threads);
+        free(workers);
+        free(queues);
+        free(scores);
+        return 1;
+    }
+
+    // contiguous starting ranges; stealing rebalances them as games finish unevenly
+    for (unsigned t = 0; t < options->threads; t++)
+    {
+        uint32_t begin = (uint32_t)((uint64_t)options->games * t / options->threads);
+        uint32_t end = (uint32_t)((uint64_t)options->games * (t + 1) / options->threads);
+        atomic_init(&queues[t].range, sim_pack(begin, end));
+        workers[t].options = options;
+        workers[t].queues = queues;
+        workers[t].thread_id = t;
+        workers[t].scores = scores;
+    }
+
+    double start = sim_now_seconds();
+    unsigned started = 0;
+    for (; started < options->threads; started++)
+    {
+        if (pthread_create(&threads[started], NULL, sim_worker_main, &workers[started]) != 0)
+            break;
+    }
+    // threads that failed to start leave their range to be stolen
+    if (started == 0)
+        sim_worker_main(&workers[0]);
+    for (unsigned t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    double seconds = sim_now_seconds() - start;
+
+    sim_report(options, workers, scores, seconds > 0.0 ? seconds : 1e-9);
+
+    free(threads);
+    free(workers);
+    free(queues);
+    free(scores);
+    return 0;
+}
+
+static int run_tournament_entrants(const SimOptions *options, const TournamentEntrant *entrants, size_t count)
+{
+    TournamentConfig config;
+    tournament_config_default(&config);
+    config.mode = options->mode;
+    config.variant = options->variant;
+    config.num_threads = options->threads;
+    config.seed = options->seed;
+    config.max_deals = options->deals;
+    if (options->players_given)
+        config.player_counts = (uint8_t)(1u << options->num_players);
+
+    TournamentRating ratings[TOURNAMENT_MAX_ENTRANTS];
+    size_t num_pairings = tournament_num_pairings(config.mode, count);
+    TournamentPairing *pairings = malloc((num_pairings + 1) * sizeof(*pairings));
+    TournamentStats stats;
+    if (!pairings || !tournament_run(&config, entrants, count, ratings, pairings, &stats))
+    {
+        fprintf(stderr, "tournament: needs at least two policies\n");
+        free(pairings);
+        return 1;
+    }
+
+    printf("%s of %zu policies (%s, seed %llu) on %u threads\n",
+           config.mode == TOURNAMENT_GAUNTLET ? "Gauntlet" : "Round robin", count,
+           options->variant == GAME_VARIANT_DRAW ? "draw" : "classic", (unsigned long long)options->seed,
+           options->threads);
+    printf("  %llu games over %u deals, %.3f s, %.0f games/s, %.0f steps/s\n", (unsigned long long)stats.games,
+           stats.deals, stats.elapsed_s, stats.games_per_sec, stats.steps_per_sec);
+    if (stats.significant)
+        printf("  Every pairing significant after %.3f s\n", stats.significant_after_s);
+    else
+        printf("  Not every pairing reached significance\n");
+
+    printf("\n  Policy               Elo   +/-    Mean   Games\n");
+    for (size_t i = 0; i < count; i++)
+        printf("  %-16s %7.1f %5.1f %7.2f %7llu\n", entrants[i].name, ratings[i].elo, ratings[i].elo_ci,
+               ratings[i].mean_score, (unsigned long long)ratings[i].games);
+
+    printf("\n  Pairing                           W-L-D     Score diff        Elo diff\n");
+    for (size_t i = 0; i < num_pairings; i++)
+    {
+        const TournamentPairing *pairing = &pairings[i];
+        printf("  %-14s %-14s %5llu-%llu-%llu  %+6.2f +/- %4.2f  %+7.1f +/- %5.1f%s\n", entrants[pairing->a].name,
+               entrants[pairing->b].name, (unsigned long long)pairing->wins_a, (unsigned long long)pairing->wins_b,
+               (unsigned long long)pairing->draws, pairing->score_diff, pairing->score_diff_ci, pairing->elo_diff,
+               pairing->elo_diff_ci, pairing->significant ? "" : "  (not significant)");
+    }
+
+    free(pairings);
+    return 0;
+}
+
+static int run_tournament(const SimOptions *options)
+{
+    TournamentEntrant entrants[TOURNAMENT_MAX_ENTRANTS];
+    PolicyPlugin *plugins[TOURNAMENT_MAX_ENTRANTS] = {NULL};
+    size_t count = 0;
+    int status = 0;
+    for (char *name = strtok(options->tournament, ","); name && status == 0; name = strtok(NULL, ","))
+    {
+        PolicyKind kind;
+        char error[256] = "";
+        if (count == TOURNAMENT_MAX_ENTRANTS)
+        {
+            fprintf(stderr, "tournament: at most %d entrants\n", TOURNAMENT_MAX_ENTRANTS);
+            status = 2;
+        }
+        else if (policy_from_name(name, &kind))
+        {
+            entrants[count++] = (TournamentEntrant){policy_name(kind), kind, NULL, NULL};
+        }
+        else if (strstr(name, ".so") && (plugins[count] = policy_plugin_load(name, error, sizeof(error))))
+        {
+            policy_plugin_entrant(plugins[count], &entrants[count]);
+            count++;
+        }
+        else
+        {
+            fprintf(stderr, "tournament: cannot load %s%s%s\n", name, strstr(name, ".so") ? ": " : "",
+                    strstr(name, ".so") ? error : "");
+            status = 2;
+        }
+    }
+    if (status == 0)
+        status = run_tournament_entrants(options, entrants, count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (plugins[i] && policy_plugin_illegal_actions(plugins[i]))
+            fprintf(stderr, "tournament: %s made %llu illegal moves, replaced by random ones\n", entrants[i].name,
+                    (unsigned long long)policy_plugin_illegal_actions(plugins[i]));
+        policy_plugin_unload(plugins[i]);
+    }
+    return status;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s                      interactive game\n"
+            "       %s --sim N [--threads T] [--players P] [--variant classic|draw]\n"
+            "          [--seed S] [--iterations K]\n"
+            "       %s --tournament POLICY,PLUGIN.so[:ARGS],... [--mode round-robin|gauntlet] [--deals N]\n"
+            "          [--threads T] [--players P] [--variant classic|draw] [--seed S]\n",
+            prog, prog, prog);
+}
+
+static bool parse_sim_options(int argc, char **argv, SimOptions *options)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    options->games = 0;
+    options->threads = cpus > 0 ? (unsigned)cpus : 1;
+    options->num_players = NUM_PLAYERS_MIN;
+    options->variant = GAME_VARIANT_CLASSIC;
+    options->seed = (uint64_t)time(NULL);
+    options->iterations = 0;
+    options->players_given = false;
+    options->tournament = NULL;
+    options->deals = 1000;
+    options->mode = TOURNAMENT_ROUND_ROBIN;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value)
+            return false;
+
+        if (strcmp(arg, "--sim") == 0)
+            options->games = (uint32_t)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--threads") == 0)
+            options->threads = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--players") == 0)
+        {
+            options->num_players = (uint8_t)strtoul(value, NULL, 10);
+            options->players_given = true;
+        }
+        else if (strcmp(arg, "--variant") == 0)
+        {
+            if (strcmp(value, "classic") == 0 || strcmp(value, "0") == 0)
+                options->variant = GAME_VARIANT_CLASSIC;
+            else if (strcmp(value, "draw") == 0 || strcmp(value, "1") == 0)
+                options->variant = GAME_VARIANT_DRAW;
+            else
+                return false;
+        }
+        else if (strcmp(arg, "--seed") == 0)
+            options->seed = strtoull(value, NULL, 0);
+        else if (strcmp(arg, "--iterations") == 0)
+            options->iterations = (uint32_t)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--tournament") == 0)
+            options->tournament = argv[i + 1]; // split in place by run_tournament
+        else if (strcmp(arg, "--deals") == 0)
+            options->deals = (uint32_t)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--mode") == 0)
+            options->mode = strcmp(value, "gauntlet") == 0 ? TOURNAMENT_GAUNTLET : TOURNAMENT_ROUND_ROBIN;
+        else
+            return false;
+        i++;
+    }
+
+    if (options->threads > SIM_MAX_THREADS)
+        options->threads = SIM_MAX_THREADS;
+    return (options->games >= 1 || (options->tournament && options->deals >= 1)) && options->threads >= 1 &&
+           options->num_players >= NUM_PLAYERS_MIN && options->num_players <= NUM_PLAYERS_MAX;
+}
+
+static int run_interactive(void)
+{
+    GameRng ai_rng;
+    game_rng_seed(&ai_rng, (uint64_t)time(NULL), 1);
 
     printf("Poison Card Game\n");
     printf("Players (%d-%d): ", NUM_PLAYERS_MIN, NUM_PLAYERS_MAX);
@@ -293,7 +779,7 @@ int main(void)
     int variant_choice = read_int_or_default(0);
     GameVariant variant = variant_choice ? GAME_VARIANT_DRAW : GAME_VARIANT_CLASSIC;
 
-    GameState *game = game_init((uint8_t)num_players, variant, (uint32_t)time(NULL));
+    GameState *game = game_init((uint8_t)num_players, variant, (uint64_t)time(NULL));
     if (!game)
     {
         printf("Failed to init game.\n");
@@ -313,7 +799,7 @@ int main(void)
             if (current == human_player)
                 step = play_human_turn(game, current);
             else
-                step = play_ai_turn(game, current);
+                step = play_ai_turn(game, current, &ai_rng);
         }
 
         show_round_results(game);
@@ -331,3 +817,17 @@ int main(void)
     game_destroy(game);
     return 0;
 }
+
+int main(int argc, char **argv)
+{
+    if (argc == 1)
+        return run_interactive();
+
+    SimOptions options;
+    if (!parse_sim_options(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    return options.tournament ? run_tournament(&options) : run_simulation(&options);
+}
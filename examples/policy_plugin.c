@@ -0,0 +1,86 @@
+// example policy plugin: fills the highest cauldron that stays at or below
+// CAULDRON_THRESHOLD - margin, otherwise takes the overflow that collects the
+// fewest cards. Build with `make plugin` and load as "./policy_plugin.so" or
+// "./policy_plugin.so:margin=2".
+
+#include "poison_plugin.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    int margin;
+} FillPolicy;
+
+static void *fill_init(const char *args)
+{
+    FillPolicy *policy = calloc(1, sizeof(*policy));
+    if (!policy)
+        return NULL;
+
+    const char *margin = strstr(args, "margin=");
+    if (margin)
+        policy->margin = atoi(margin + strlen("margin="));
+    return policy;
+}
+
+static int fill_score(const FillPolicy *policy, const GameState *state, uint16_t action)
+{
+    uint8_t player = game_get_current_player(state);
+    uint8_t cauldron = (uint8_t)(action % NUM_CAULDRONS);
+    Card card;
+    if (!game_get_player_hand_card(state, player, (uint8_t)(action / NUM_CAULDRONS), &card))
+        return -1000000;
+
+    int total = game_get_cauldron_total_value(state, cauldron) + card.value;
+    if (total <= CAULDRON_THRESHOLD - policy->margin)
+        return 1000 + total;
+    return -100 * game_get_cauldron_num_cards(state, cauldron) + card.value;
+}
+
+static bool fill_act(void *instance, const PolicyPluginBatch *batch, uint16_t *out_actions)
+{
+    const FillPolicy *policy = instance;
+
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        const uint8_t *mask = batch->masks + i * batch->mask_stride;
+        int best_score = 0;
+        out_actions[i] = 0;
+        bool found = false;
+
+        for (uint16_t action = 0; action < batch->mask_stride; action++)
+        {
+            if (!mask[action])
+                continue;
+            int score = fill_score(policy, batch->states[i], action);
+            if (!found || score > best_score)
+            {
+                out_actions[i] = action;
+                best_score = score;
+                found = true;
+            }
+        }
+    }
+    return true;
+}
+
+static void fill_destroy(void *instance)
+{
+    free(instance);
+}
+
+static const PolicyPluginApi FILL_API = {
+    POLICY_PLUGIN_ABI_VERSION,
+    POLICY_PLUGIN_WANTS_MASK | POLICY_PLUGIN_THREAD_SAFE,
+    "fill",
+    fill_init,
+    fill_act,
+    fill_destroy,
+};
+
+const PolicyPluginApi *poison_policy_plugin(void)
+{
+    return &FILL_API;
+}
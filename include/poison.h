@@ -9,6 +9,7 @@
 #define NUM_PLAYERS_MAX 6
 #define NUM_CAULDRONS 3
 #define CAULDRON_THRESHOLD 13
+#define NUM_CARD_TYPES 16 // red, blue, purple potions by value (1, 2, 4, 5, 7), then poison
 
 typedef enum
 {
@@ -36,6 +37,17 @@ typedef enum
     GAME_OBS_PARTIAL = 1
 } GameObsMode;
 
+// element encodings of an observation. U8/I8 keep the float layout one byte per
+// feature (U8 stores the non-positive score negated); BITS packs each feature
+// into a fixed-width field. Values outside a format's range saturate.
+typedef enum
+{
+    GAME_OBS_FORMAT_F32 = 0,
+    GAME_OBS_FORMAT_U8 = 1,
+    GAME_OBS_FORMAT_I8 = 2,
+    GAME_OBS_FORMAT_BITS = 3
+} GameObsFormat;
+
 typedef struct
 {
     CardType type;
@@ -44,6 +56,16 @@ typedef struct
 } Card;
 
 typedef struct GameState GameState;
+typedef struct GameBatch GameBatch;
+
+// PCG32 (XSH-RR): 64-bit LCG state, output permuted to 32 bits. inc is odd and
+// selects one of 2^63 independent streams. Fields are private; use game_rng_*.
+typedef struct
+{
+    uint64_t state;
+    uint64_t inc;
+} GameRng;
+typedef struct GamePool GamePool;
 
 typedef struct
 {
@@ -54,13 +76,61 @@ typedef struct
     int8_t winner;
 } StepResult;
 
+// flags for game_step_observe
+#define GAME_STEP_AUTO_ROUND 0x1u // start the next round when a step ends one but not the game
+#define GAME_STEP_AUTO_RESET 0x2u // re-deal a finished game with a fresh seed
+// batches and env pools give the k-th re-deal of env i game_seed_for(seed, i, k),
+// so both play the same games from the same base seed; a lone game_step_observe
+// draws the new seed from the finished game's own rng
+
+typedef struct
+{
+    StepResult step;
+    int32_t scores[NUM_PLAYERS_MAX]; // cumulative scores right after the action
+    bool round_started;              // GAME_STEP_AUTO_ROUND dealt a new round
+    bool game_reset;                 // GAME_STEP_AUTO_RESET started a new game
+    uint64_t reset_seed;             // seed of that new game, for recording
+} GameStepOutput;
+
+// undo record for one game_step_with_undo; contents are private to the engine
+#define GAME_UNDO_WORDS 12
+
+typedef struct
+{
+    uint64_t opaque[GAME_UNDO_WORDS];
+} GameUndo;
+
+// random numbers. Seeds are hashed before use, so nearby seeds give unrelated
+// sequences; game_rng_advance skips ahead in O(log delta) and game_rng_split
+// derives a child on a fresh stream for handing to another thread.
+void game_rng_seed(GameRng *rng, uint64_t seed, uint64_t stream);
+uint32_t game_rng_next(GameRng *rng);
+uint64_t game_rng_next64(GameRng *rng);
+// unbiased value in [0, bound) (Lemire's method); 0 when bound is 0
+uint32_t game_rng_bounded(GameRng *rng, uint32_t bound);
+void game_rng_advance(GameRng *rng, uint64_t delta);
+GameRng game_rng_split(GameRng *rng);
+// game seed for episode `episode` of env `env_id` in a run seeded with `base`:
+// the episode-th 64-bit draw of stream env_id (env_id < 2^63). Batches and env
+// pools deal env i from game_seed_for(seed, i, 0).
+uint64_t game_seed_for(uint64_t base, uint64_t env_id, uint64_t episode);
+
 // lifecycle
-GameState *game_init(uint8_t num_players, GameVariant variant, uint32_t seed);
+GameState *game_init(uint8_t num_players, GameVariant variant, uint64_t seed);
 void game_destroy(GameState *state);
 void game_reset(GameState *state);
+bool game_init_into(GameState *state, uint8_t num_players, GameVariant variant, uint64_t seed);
+
+// copying: clones are freed with game_destroy
+GameState *game_clone(const GameState *state);
+void game_copy_into(GameState *dst, const GameState *src);
 
 // step
 StepResult game_step_action(GameState *state, uint16_t action_id);
+// make/unmake: undo records must be applied in reverse order, and only
+// for steps taken since the last game_start_new_round or game_reset
+StepResult game_step_with_undo(GameState *state, uint16_t action_id, GameUndo *undo);
+void game_undo(GameState *state, const GameUndo *undo);
 
 // rounds & scoring
 void game_start_new_round(GameState *state);
@@ -73,12 +143,18 @@ uint8_t game_get_num_players(const GameState *state);
 uint8_t game_get_current_player(const GameState *state);
 uint8_t game_get_dealer(const GameState *state);
 uint8_t game_get_round(const GameState *state);
+// Zobrist key of the position, maintained incrementally; hands and piles are
+// hashed as multisets so equal positions reached by different orders match
+uint64_t game_get_hash(const GameState *state);
 
 // player info
 uint8_t game_get_player_hand_size(const GameState *state, uint8_t player);
 uint8_t game_get_player_collected_size(const GameState *state, uint8_t player);
 int32_t game_get_player_score(const GameState *state, uint8_t player);
 bool game_get_player_hand_card(const GameState *state, uint8_t player, uint8_t card_index, Card *out);
+// collected piles keep counts per card type, not the order cards were taken:
+// card_index walks the pile grouped by type, in card type order (red, blue,
+// purple by value, then poison)
 bool game_get_player_collected_card(const GameState *state, uint8_t player, uint8_t card_index, Card *out);
 
 // cauldrons
@@ -90,9 +166,107 @@ bool game_get_cauldron_card(const GameState *state, uint8_t cauldron, uint8_t ca
 // observation
 size_t game_observation_size(void);
 size_t game_get_observation(const GameState *state, uint8_t perspective_player, GameObsMode mode, float *out, size_t out_len);
+// every seat's view in one pass: seat p's observation starts at out + p * stride
+size_t game_get_observations_all(const GameState *state, GameObsMode mode, float *out, size_t stride, size_t out_len);
+size_t game_observation_bytes(GameObsFormat format);
+// returns bytes written, 0 if out_bytes < game_observation_bytes(format)
+size_t game_get_observation_encoded(const GameState *state, uint8_t perspective_player, GameObsMode mode,
+                                    GameObsFormat format, void *out, size_t out_bytes);
+// expands an encoded observation back to the float layout of game_get_observation
+size_t game_decode_observation(const void *encoded, GameObsFormat format, float *out, size_t out_len);
 
 // actions
 uint16_t game_action_space_size(void);
 size_t game_get_legal_action_mask(const GameState *state, uint8_t *out_mask, size_t out_len);
+size_t game_legal_action_words(void);
+// bit i of out_words[i / 64] set = action i legal; returns the count, or 0 (writing
+// nothing) when out_len < game_legal_action_words()
+size_t game_get_legal_action_bits(const GameState *state, uint64_t *out_words, size_t out_len);
+// uniform over legal actions; returns 0 (a pass) when the current player has no cards
+uint16_t game_sample_legal_action(const GameState *state, GameRng *rng);
+
+// typed actions: id = card type * NUM_CAULDRONS + cauldron, 48 in all. Identical
+// cards share one id, so the space has no duplicates and does not depend on hand
+// order. The typed mask and bits mark the same moves as the positional mask.
+uint16_t game_typed_action_space_size(void);
+// card type id (0..NUM_CARD_TYPES-1) of a card, UINT8_MAX if it matches none
+uint8_t game_card_type_id(const Card *card);
+bool game_card_from_type_id(uint8_t type_id, Card *out);
+StepResult game_step_typed_action(GameState *state, uint16_t typed_action);
+size_t game_get_typed_legal_action_mask(const GameState *state, uint8_t *out_mask, size_t out_len);
+// all typed ids fit one word, so exactly one uint64_t is written to out_bits:
+// bit i set = typed action i legal. Returns the count.
+size_t game_get_typed_legal_action_bits(const GameState *state, uint64_t *out_bits);
+// translation for the current player; UINT16_MAX when the id names no card in hand.
+// A typed id maps to the first hand slot holding that type.
+uint16_t game_action_to_typed(const GameState *state, uint16_t action_id);
+uint16_t game_typed_to_action(const GameState *state, uint16_t typed_action);
+
+// colour symmetry: red, blue and purple follow the same rules, so every position
+// has up to 6 equivalent relabellings. Permutation p (0..5, 0 = identity) sends
+// colour c to game_color_perm_apply(p, c); compose(a, b) applies a, then b.
+// Permuting moves card types, typed action ids and per-type features, while
+// positional action ids (and so positional masks) are unchanged.
+#define GAME_NUM_COLOR_PERMS 6
+Color game_color_perm_apply(uint8_t perm, Color color);
+uint8_t game_color_perm_inverse(uint8_t perm);
+uint8_t game_color_perm_compose(uint8_t first, uint8_t second);
+// relabels every card in the state and refreshes features and hash; out may be state
+bool game_permute_colors(const GameState *state, uint8_t perm, GameState *out);
+// the permutation that takes state to its canonical colouring. Colour-equivalent
+// states canonicalize to the same state, and states that also differ only in
+// hand or cauldron order reach the same hash.
+uint8_t game_canonical_color_perm(const GameState *state);
+// writes the canonical state to out (out may be state); returns the permutation used
+uint8_t game_canonicalize(const GameState *state, GameState *out);
+// observation vectors (game_observation_size floats); out may be obs
+size_t game_permute_observation(const float *obs, uint8_t perm, float *out, size_t out_len);
+// canonicalizes from what the observation shows, so the permutation can differ from
+// the state's; returns the permutation used
+uint8_t game_canonicalize_observation(const float *obs, float *out, size_t out_len);
+// typed ids, masks (game_typed_action_space_size entries; out may be mask) and bits
+uint16_t game_permute_typed_action(uint16_t typed_action, uint8_t perm);
+size_t game_permute_typed_action_mask(const uint8_t *mask, uint8_t perm, uint8_t *out, size_t out_len);
+uint64_t game_permute_typed_action_bits(uint64_t bits, uint8_t perm);
+
+// step, apply the GAME_STEP_* transitions, then write the next observation (of
+// the player now to move, in format) and legal mask. obs and mask are optional.
+bool game_step_observe(GameState *state, uint16_t action_id, uint32_t flags, GameObsMode mode, GameObsFormat format,
+                       GameStepOutput *out_result, void *out_obs, size_t obs_bytes, uint8_t *out_mask,
+                       size_t mask_len);
+
+// batched environments: N games in one allocation, observed from each game's current player
+GameBatch *game_batch_create(size_t num_envs, uint8_t num_players, GameVariant variant, uint64_t seed);
+void game_batch_destroy(GameBatch *batch);
+void game_batch_reset(GameBatch *batch);
+size_t game_batch_size(const GameBatch *batch);
+GameState *game_batch_get_state(GameBatch *batch, size_t env);
+size_t game_batch_step(GameBatch *batch, const uint16_t *action_ids, float *out_rewards, bool *out_dones, StepResult *out_results);
+size_t game_batch_get_observations(const GameBatch *batch, GameObsMode mode, float *out, size_t out_len);
+// game_step_observe for every env; obs and masks are packed env after env
+size_t game_batch_step_observe(GameBatch *batch, const uint16_t *action_ids, uint32_t flags, GameObsMode mode,
+                               GameObsFormat format, GameStepOutput *out_results, void *out_obs, size_t obs_bytes,
+                               uint8_t *out_masks, size_t mask_len);
+size_t game_batch_get_observations_encoded(const GameBatch *batch, GameObsMode mode, GameObsFormat format, void *out,
+                                           size_t out_bytes);
+size_t game_batch_get_legal_action_masks(const GameBatch *batch, uint8_t *out_masks, size_t out_len);
+size_t game_batch_get_typed_legal_action_masks(const GameBatch *batch, uint8_t *out_masks, size_t out_len);
+
+// determinization: fills out_states with full states consistent with what
+// `perspective` has seen, resampling other hands and the undealt deck.
+// void_colors (optional, one per player) holds bits (1 << Color) of colours
+// that player is known not to hold. Returns the number of states written;
+// they occupy the first slots of out_states.
+size_t game_determinize(const GameState *state, uint8_t perspective, const uint8_t *void_colors,
+                        GameState *const *out_states, size_t count, GameRng *rng);
+
+// state pool: cache-line aligned slots from one arena, not thread-safe.
+// acquired slots are uninitialised until game_init_into or game_copy_into;
+// never pass them to game_destroy
+GamePool *game_pool_create(size_t capacity);
+void game_pool_destroy(GamePool *pool);
+GameState *game_pool_acquire(GamePool *pool);
+void game_pool_release(GamePool *pool, GameState *state);
+size_t game_pool_available(const GamePool *pool);
 
 #endif // POISON_H
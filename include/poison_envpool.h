@@ -0,0 +1,56 @@
+#ifndef POISON_ENVPOOL_H
+#define POISON_ENVPOOL_H
+
+#include "poison.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// asynchronous pool of games stepped by worker threads. Env i is owned by
+// worker i % num_threads, which keeps its games in a GamePool arena allocated
+// on that thread. send() queues work without blocking, and recv() returns
+// whichever envs finish first, so stepping overlaps with the caller's inference.
+typedef struct GameEnvPool GameEnvPool;
+
+// action id that starts a new game instead of stepping; the first reset of an
+// env reports its initial deal. The k-th re-deal of an env, whether by reset or
+// by GAME_STEP_AUTO_RESET, uses game_seed_for(seed, env, k).
+#define GAME_ENV_ACTION_RESET UINT16_MAX
+
+typedef struct
+{
+    uint32_t num_envs;
+    uint32_t num_threads;
+    uint8_t num_players;
+    GameVariant variant;
+    uint64_t seed;  // env i starts from game_seed_for(seed, i, 0)
+    uint32_t flags; // GAME_STEP_* applied to every step
+    GameObsMode obs_mode;
+    GameObsFormat obs_format;
+    bool pin_threads; // pin worker t to CPU t (Linux only)
+} GameEnvPoolConfig;
+
+// recv destinations, entry k describes the k-th returned env; any may be NULL
+typedef struct
+{
+    uint32_t *env_ids;
+    GameStepOutput *results;
+    uint8_t *players; // player to move next
+    void *obs;        // game_observation_bytes(obs_format) per env
+    uint8_t *masks;   // game_action_space_size() per env
+} GameEnvPoolBatch;
+
+void game_env_pool_config_default(GameEnvPoolConfig *config);
+GameEnvPool *game_env_pool_create(const GameEnvPoolConfig *config);
+void game_env_pool_destroy(GameEnvPool *pool);
+size_t game_env_pool_size(const GameEnvPool *pool);
+
+// queues one action per env; each env may have one request in flight. Returns
+// how many were accepted (unknown or busy envs are skipped).
+size_t game_env_pool_send(GameEnvPool *pool, const uint32_t *env_ids, const uint16_t *actions, size_t count);
+// blocks until batch_size envs are ready, clamped to the number in flight;
+// returns 0 at once when nothing is in flight
+size_t game_env_pool_recv(GameEnvPool *pool, size_t batch_size, const GameEnvPoolBatch *out);
+
+#endif // POISON_ENVPOOL_H
@@ -0,0 +1,45 @@
+#ifndef POISON_MCTS_H
+#define POISON_MCTS_H
+
+#include "poison.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum
+{
+    MCTS_PARALLEL_ROOT = 0,
+    MCTS_PARALLEL_TREE = 1
+} MctsParallelMode;
+
+typedef struct
+{
+    uint32_t iterations;     // playouts across all threads, 0 = time budget only
+    uint32_t time_budget_ms; // 0 = iteration budget only
+    uint8_t num_threads;
+    MctsParallelMode parallel_mode;
+    GameObsMode obs_mode; // GAME_OBS_PARTIAL determinizes hidden hands per playout
+    const uint8_t *void_colors; // optional, see game_determinize
+    float exploration;
+    uint32_t virtual_loss; // phantom losses per in-flight traversal (tree mode)
+    uint32_t max_nodes;    // per tree
+    uint64_t seed;
+} MctsConfig;
+
+typedef struct
+{
+    uint64_t iterations;
+    uint64_t nodes;
+    double elapsed_ms;
+    double playouts_per_sec;
+} MctsStats;
+
+void mcts_config_default(MctsConfig *config);
+
+// information-set MCTS from the current player's seat. Playouts run to the end
+// of the round; collected piles and cauldrons are treated as public. Writes the
+// normalised root visit distribution over game_action_space_size() ids.
+size_t mcts_search(const GameState *state, uint8_t player, const MctsConfig *config,
+                   float *out_visits, size_t out_len, MctsStats *stats);
+
+#endif // POISON_MCTS_H
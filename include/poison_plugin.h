@@ -0,0 +1,67 @@
+#ifndef POISON_PLUGIN_H
+#define POISON_PLUGIN_H
+
+#include "poison.h"
+#include "poison_tournament.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// policy plugins: shared objects built against libpoison.so that export
+//     const PolicyPluginApi *poison_policy_plugin(void);
+// States stay opaque to plugins, which read them through the public game_*
+// API or through the observations and masks the loader prepares on request.
+#define POLICY_PLUGIN_ABI_VERSION 1
+#define POLICY_PLUGIN_SYMBOL "poison_policy_plugin"
+
+#define POLICY_PLUGIN_WANTS_OBS 0x1u   // partial f32 observation of each state's player to move
+#define POLICY_PLUGIN_WANTS_MASK 0x2u  // positional legal action mask of each state
+#define POLICY_PLUGIN_THREAD_SAFE 0x4u // act may run concurrently on one instance
+
+typedef struct
+{
+    size_t count;
+    const GameState *const *states;
+    const float *obs;     // count rows of obs_stride floats, NULL unless requested
+    size_t obs_stride;
+    const uint8_t *masks; // count rows of mask_stride bytes, NULL unless requested
+    size_t mask_stride;
+    GameRng *rng;
+} PolicyPluginBatch;
+
+typedef struct
+{
+    uint32_t abi_version; // POLICY_PLUGIN_ABI_VERSION
+    uint32_t flags;       // POLICY_PLUGIN_*
+    const char *name;
+    // args is the text after ':' in the load spec, or "" when there is none
+    void *(*init)(const char *args);
+    // one positional action id per state, for that state's player to move
+    bool (*act)(void *instance, const PolicyPluginBatch *batch, uint16_t *out_actions);
+    void (*destroy)(void *instance);
+} PolicyPluginApi;
+
+typedef const PolicyPluginApi *(*PolicyPluginEntry)(void);
+
+// loader side
+typedef struct PolicyPlugin PolicyPlugin;
+
+// spec is "path.so" or "path.so:args". Returns NULL on failure and, when
+// error is given, a reason in it.
+PolicyPlugin *policy_plugin_load(const char *spec, char *error, size_t error_len);
+void policy_plugin_unload(PolicyPlugin *plugin);
+const char *policy_plugin_name(const PolicyPlugin *plugin);
+
+// prepares the requested inputs and calls act. Illegal or missing actions are
+// replaced with uniform legal moves so games always advance; see
+// policy_plugin_illegal_actions. Calls are serialised unless the plugin is
+// thread-safe.
+bool policy_plugin_act(PolicyPlugin *plugin, const GameState *const *states, size_t count, GameRng *rng,
+                       uint16_t *out_actions);
+uint64_t policy_plugin_illegal_actions(const PolicyPlugin *plugin);
+
+// tournament entrant that plays through policy_plugin_act
+void policy_plugin_entrant(PolicyPlugin *plugin, TournamentEntrant *out);
+
+#endif // POISON_PLUGIN_H
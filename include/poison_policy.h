@@ -0,0 +1,35 @@
+#ifndef POISON_POLICY_H
+#define POISON_POLICY_H
+
+#include "poison.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// built-in opponents that read the engine state directly. Each returns a
+// positional action id for the player to move (0, a pass, when the hand is
+// empty). Ties are broken uniformly with rng; with rng NULL the lowest id wins
+// and POLICY_RANDOM plays the first legal move.
+typedef enum
+{
+    POLICY_RANDOM = 0,      // uniform over legal moves
+    POLICY_MIN_COLLECT,     // fewest cards collected by this move, highest card among those
+    POLICY_AVOID_OVERFLOW,  // highest cauldron that does not overflow; cheapest overflow when forced
+    POLICY_POISON_DUMP,     // avoid-overflow, but a poison that fits goes first
+    POLICY_LOOKAHEAD,       // best own round score once the move resolves, immunity included
+    POLICY_NUM_KINDS
+} PolicyKind;
+
+const char *policy_name(PolicyKind kind);
+// accepts the names returned by policy_name
+bool policy_from_name(const char *name, PolicyKind *out_kind);
+
+uint16_t policy_act(PolicyKind kind, const GameState *state, GameRng *rng);
+// one action per state, all drawn from the same rng; returns the count written
+size_t policy_act_batch(PolicyKind kind, const GameState *const *states, size_t count, GameRng *rng,
+                        uint16_t *out_actions);
+// one action per env of a GameBatch, for its current players
+size_t policy_act_game_batch(PolicyKind kind, GameBatch *batch, GameRng *rng, uint16_t *out_actions);
+
+#endif // POISON_POLICY_H
@@ -0,0 +1,63 @@
+#ifndef POISON_PROFILE_H
+#define POISON_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// hot-path instrumentation, compiled in only when the library is built with
+// -DPOISON_PROFILE (make PROFILE=1). Without it the probes vanish and
+// game_profile_snapshot reports enabled = false.
+typedef enum
+{
+    GAME_PROFILE_INIT = 0,
+    GAME_PROFILE_RESET,
+    GAME_PROFILE_CLONE,
+    GAME_PROFILE_COPY,
+    GAME_PROFILE_STEP,
+    GAME_PROFILE_STEP_WITH_UNDO,
+    GAME_PROFILE_STEP_OBSERVE,
+    GAME_PROFILE_STEP_TYPED,
+    GAME_PROFILE_UNDO,
+    GAME_PROFILE_NEW_ROUND,
+    GAME_PROFILE_OBSERVATION,
+    GAME_PROFILE_OBSERVATION_ENCODED,
+    GAME_PROFILE_OBSERVATIONS_ALL,
+    GAME_PROFILE_LEGAL_MASK,
+    GAME_PROFILE_LEGAL_BITS,
+    GAME_PROFILE_LEGAL_TYPED_MASK,
+    GAME_PROFILE_LEGAL_TYPED_BITS,
+    GAME_PROFILE_SAMPLE_ACTION,
+    GAME_PROFILE_BATCH_STEP,
+    GAME_PROFILE_BATCH_STEP_OBSERVE,
+    GAME_PROFILE_BATCH_OBSERVATIONS,
+    GAME_PROFILE_BATCH_MASKS,
+    GAME_PROFILE_DETERMINIZE,
+    GAME_PROFILE_NUM_POINTS
+} GameProfilePoint;
+
+// bucket b counts calls that took [2^b, 2^(b+1)) ticks; bucket 0 also holds 0
+#define GAME_PROFILE_BUCKETS 40
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t total_ticks;
+    uint64_t max_ticks;
+    uint64_t histogram[GAME_PROFILE_BUCKETS];
+} GameProfileEntry;
+
+typedef struct
+{
+    bool enabled;
+    const char *tick_unit; // "cycles" (rdtsc) or "ns" (clock_gettime)
+    GameProfileEntry entries[GAME_PROFILE_NUM_POINTS];
+} GameProfileSnapshot;
+
+const char *game_profile_point_name(GameProfilePoint point);
+
+// sums the counters of every thread that has entered the library so far,
+// including threads that have since exited
+bool game_profile_snapshot(GameProfileSnapshot *out);
+void game_profile_reset(void);
+
+#endif // POISON_PROFILE_H
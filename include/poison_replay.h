@@ -0,0 +1,82 @@
+#ifndef POISON_REPLAY_H
+#define POISON_REPLAY_H
+
+#include "poison.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Trajectory files hold whole games as (seed, players, variant, actions). Each
+// action is stored as its rank among the legal actions at that step, using
+// just enough bits to cover them, so a 3-player game takes well under 100 bytes.
+// Rewards and observations can optionally be stored as well. Replays
+// re-simulate from the seed, and start the next round whenever a step ends one
+// without ending the game. Files use host byte order (little-endian in practice).
+
+#define REPLAY_RECORD_REWARDS 0x1u
+#define REPLAY_RECORD_OBSERVATIONS 0x2u
+
+typedef struct ReplayWriter ReplayWriter;
+typedef struct ReplayReader ReplayReader;
+
+typedef struct
+{
+    uint64_t seed;
+    uint8_t num_players;
+    GameVariant variant;
+    uint32_t flags;       // REPLAY_RECORD_* streams present in this game
+    GameObsMode obs_mode; // mode of the stored observations
+    uint32_t num_steps;
+} ReplayGameInfo;
+
+typedef struct
+{
+    uint16_t action_id;
+    uint8_t player;
+    float reward;
+    bool round_done;
+    bool done;
+    const float *stored_obs; // recorded observation inside the mapping, or NULL
+} ReplayStep;
+
+// streaming position inside one game; fields are private to the reader
+typedef struct
+{
+    const ReplayReader *reader;
+    GameState *state;
+    const uint8_t *actions;
+    const float *rewards;
+    const float *observations;
+    uint64_t bit_pos;
+    uint32_t action_bytes;
+    uint32_t step;
+    uint32_t num_steps;
+    GameObsMode obs_mode;
+} ReplayCursor;
+
+// creates (or truncates) path; flags selects the optional per-step streams
+ReplayWriter *replay_writer_open(const char *path, uint32_t flags, GameObsMode obs_mode);
+// state must be fresh from game_init / game_init_into with this seed
+bool replay_writer_begin_game(ReplayWriter *writer, const GameState *state, uint64_t seed);
+// steps state and records the action; illegal actions leave both untouched.
+// Starts the next round itself when a round ends before the game does.
+StepResult replay_writer_step(ReplayWriter *writer, GameState *state, uint16_t action_id);
+bool replay_writer_end_game(ReplayWriter *writer);
+// writes the game index; an unfinished game is dropped
+bool replay_writer_close(ReplayWriter *writer);
+
+ReplayReader *replay_reader_open(const char *path);
+void replay_reader_close(ReplayReader *reader);
+size_t replay_reader_num_games(const ReplayReader *reader);
+bool replay_reader_game_info(const ReplayReader *reader, size_t game, ReplayGameInfo *out);
+
+// rewinds state (any GameState, e.g. from a GamePool) to the start of game
+bool replay_cursor_init(ReplayCursor *cursor, const ReplayReader *reader, size_t game, GameState *state);
+// writes the pre-step observation (cursor obs mode, mover's perspective) and
+// legal mask when buffers are given, then replays one action. False at the end,
+// once the replayed game is over, or when the action stream runs out.
+bool replay_cursor_next(ReplayCursor *cursor, ReplayStep *out, float *obs, size_t obs_len, uint8_t *mask,
+                        size_t mask_len);
+
+#endif // POISON_REPLAY_H
@@ -0,0 +1,40 @@
+#ifndef POISON_SOLVER_H
+#define POISON_SOLVER_H
+
+#include "poison.h"
+#include "poison_tt.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    SOLVER_MAXN = 0,    // every player maximises their own round score
+    SOLVER_PARANOID = 1 // the player to move maximises, everyone else minimises it
+} SolverMode;
+
+typedef struct
+{
+    SolverMode mode;
+    uint8_t max_hand_cards;  // solve only when at most this many cards remain in hands
+    TranspositionTable *tt;  // optional; a private table is used when NULL
+} SolverConfig;
+
+typedef struct
+{
+    uint64_t nodes;
+    uint64_t tt_hits;
+    double elapsed_ms;
+    double nodes_per_sec;
+} SolverStats;
+
+void solver_config_default(SolverConfig *config);
+
+// exact end-of-round solve for GAME_VARIANT_CLASSIC with every hand known.
+// Returns false when the position is out of scope (draw variant, round over,
+// too many cards left). out_round_scores receives this round's score per
+// player under optimal play (for paranoid, only the mover's entry is exact)
+bool solver_solve(const GameState *state, const SolverConfig *config, uint16_t *out_action,
+                  int32_t *out_round_scores, SolverStats *stats);
+
+#endif // POISON_SOLVER_H
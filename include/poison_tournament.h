@@ -0,0 +1,96 @@
+#ifndef POISON_TOURNAMENT_H
+#define POISON_TOURNAMENT_H
+
+#include "poison.h"
+#include "poison_policy.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// batched decision callback: one action per state, for that state's current
+// player. Worker threads call it concurrently, so ctx must be thread-safe; rng
+// belongs to the calling thread.
+typedef void (*TournamentActFn)(void *ctx, const GameState *const *states, size_t count, GameRng *rng,
+                                uint16_t *out_actions);
+
+typedef struct
+{
+    const char *name;
+    PolicyKind policy; // built-in policy, used when act is NULL
+    TournamentActFn act;
+    void *ctx;
+} TournamentEntrant;
+
+typedef enum
+{
+    TOURNAMENT_ROUND_ROBIN = 0, // every pair of entrants
+    TOURNAMENT_GAUNTLET = 1     // entrant 0 against each of the others
+} TournamentMode;
+
+// a pairing plays each deal as a duplicate set: the same seed under every
+// distinct rotation of alternating seats, and the mirror with the entrants
+// swapped, so both sit in every seat equally often. All pairings share deals.
+typedef struct
+{
+    TournamentMode mode;
+    uint8_t player_counts;   // bit n set = play n-player games
+    GameVariant variant;
+    uint32_t max_deals;      // per pairing and player count
+    uint32_t min_deals;      // played before the first significance check
+    uint32_t check_interval; // deals between checks
+    uint32_t num_threads;
+    uint32_t batch_sets;     // duplicate sets a worker plays in lockstep, batching act calls
+    uint64_t seed;
+    double z;                // confidence half-width in standard errors (1.96 = 95%)
+    bool stop_when_significant;
+} TournamentConfig;
+
+// Bradley-Terry fit on game results (draws count half), in Elo points centred
+// on the field mean; elo_ci comes from the inverse Hessian
+typedef struct
+{
+    double elo;
+    double elo_ci;
+    double mean_score; // final score per seat
+    uint64_t games;
+} TournamentRating;
+
+// a game goes to whichever entrant has the better mean seat score
+typedef struct
+{
+    uint32_t a;
+    uint32_t b;
+    uint64_t games;
+    uint64_t wins_a;
+    uint64_t wins_b;
+    uint64_t draws;
+    uint64_t sets;
+    double score_diff;    // a's mean seat score minus b's, averaged over duplicate sets
+    double score_diff_ci; // z standard errors across duplicate sets
+    double elo_diff;      // a minus b
+    double elo_diff_ci;
+    bool significant;     // score_diff_ci excludes zero
+} TournamentPairing;
+
+typedef struct
+{
+    uint64_t games;
+    uint64_t steps;
+    uint32_t deals; // per pairing and player count
+    double elapsed_s;
+    double games_per_sec;
+    double steps_per_sec;
+    double significant_after_s; // first time every pairing was significant, < 0 if never
+    bool significant;
+} TournamentStats;
+
+void tournament_config_default(TournamentConfig *config);
+size_t tournament_num_pairings(TournamentMode mode, size_t num_entrants);
+
+// out_ratings holds num_entrants entries and out_pairings
+// tournament_num_pairings entries; either may be NULL
+bool tournament_run(const TournamentConfig *config, const TournamentEntrant *entrants, size_t num_entrants,
+                    TournamentRating *out_ratings, TournamentPairing *out_pairings, TournamentStats *stats);
+
+#endif // POISON_TOURNAMENT_H
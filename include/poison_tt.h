@@ -0,0 +1,21 @@
+#ifndef POISON_TT_H
+#define POISON_TT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// fixed-size, lock-free transposition table keyed by game_get_hash. Entries
+// hold one opaque 64-bit payload; concurrent readers and writers never see a
+// torn entry, and any thread may store or probe at any time
+typedef struct TranspositionTable TranspositionTable;
+
+TranspositionTable *tt_create(size_t num_entries);
+void tt_destroy(TranspositionTable *tt);
+void tt_clear(TranspositionTable *tt);
+size_t tt_capacity(const TranspositionTable *tt);
+
+bool tt_probe(const TranspositionTable *tt, uint64_t key, uint64_t *out_data);
+void tt_store(TranspositionTable *tt, uint64_t key, uint64_t data);
+
+#endif // POISON_TT_H
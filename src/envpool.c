@@ -0,0 +1,458 @@
+#define _GNU_SOURCE
+
+#include "poison_envpool.h"
+#include "poison_internal.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ENV_POOL_MAX_THREADS 256
+
+// bounded MPMC ring (Vyukov): each cell's sequence number tells producers and
+// consumers whose turn it is, so push and pop never take a lock
+typedef struct
+{
+    _Atomic size_t sequence;
+    uint64_t value;
+} EnvQueueCell;
+
+typedef struct
+{
+    EnvQueueCell *cells;
+    size_t mask;
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t enqueue_pos;
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t dequeue_pos;
+} EnvQueue;
+
+// per-env output written by the owning worker and copied out by recv
+typedef struct
+{
+    GameStepOutput result;
+    uint8_t player;
+    bool started;
+    uint64_t episode;
+    uint8_t *obs;
+    uint8_t *mask;
+} EnvSlot;
+
+typedef struct
+{
+    GameEnvPool *pool;
+    uint32_t index;
+    pthread_t thread;
+    sem_t tasks_ready;
+    EnvQueue tasks;
+    GamePool *arena;
+    uint8_t *buffers;
+} EnvWorker;
+
+struct GameEnvPool
+{
+    GameEnvPoolConfig config;
+    size_t obs_bytes;
+    size_t mask_bytes;
+    EnvWorker *workers;
+    uint32_t num_started;
+    GameState **states;
+    EnvSlot *slots;
+    _Atomic uint8_t *in_flight;
+    _Atomic size_t outstanding; // accepted by send, not yet returned by recv
+    EnvQueue results;
+    sem_t results_ready;
+    sem_t workers_ready;
+    _Atomic bool init_failed;
+    _Atomic bool stopping;
+};
+
+static bool env_queue_init(EnvQueue *queue, size_t min_capacity)
+{
+    size_t capacity = 2;
+    while (capacity < min_capacity)
+        capacity *= 2;
+
+    queue->cells = malloc(capacity * sizeof(EnvQueueCell));
+    if (!queue->cells)
+        return false;
+
+    for (size_t i = 0; i < capacity; i++)
+        atomic_init(&queue->cells[i].sequence, i);
+    queue->mask = capacity - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    return true;
+}
+
+static bool env_queue_push(EnvQueue *queue, uint64_t value)
+{
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    EnvQueueCell *cell;
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->value = value;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+static bool env_queue_pop(EnvQueue *queue, uint64_t *out_value)
+{
+    size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    EnvQueueCell *cell;
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *out_value = cell->value;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+    return true;
+}
+
+void game_env_pool_config_default(GameEnvPoolConfig *config)
+{
+    if (!config)
+        return;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    config->num_envs = 64;
+    config->num_threads = cpus > 0 ? (uint32_t)cpus : 1;
+    config->num_players = NUM_PLAYERS_MIN;
+    config->variant = GAME_VARIANT_CLASSIC;
+    config->seed = 0x2545F491u;
+    config->flags = GAME_STEP_AUTO_ROUND | GAME_STEP_AUTO_RESET;
+    config->obs_mode = GAME_OBS_PARTIAL;
+    config->obs_format = GAME_OBS_FORMAT_F32;
+    config->pin_threads = false;
+}
+
+static void env_sem_wait(sem_t *sem)
+{
+    while (sem_wait(sem) != 0 && errno == EINTR)
+        ;
+}
+
+static uint32_t env_worker_count(const GameEnvPool *pool, const EnvWorker *worker)
+{
+    uint32_t threads = pool->config.num_threads;
+    return (pool->config.num_envs - worker->index + threads - 1) / threads;
+}
+
+// games and output buffers are allocated here so they are first touched, and
+// therefore placed, by the thread that steps them
+static bool env_worker_init(EnvWorker *worker)
+{
+    GameEnvPool *pool = worker->pool;
+    const GameEnvPoolConfig *config = &pool->config;
+    uint32_t count = env_worker_count(pool, worker);
+    size_t slot_bytes = pool->obs_bytes + pool->mask_bytes;
+
+    worker->arena = game_pool_create(count);
+    worker->buffers = malloc(count * slot_bytes);
+    if (!worker->arena || !worker->buffers)
+        return false;
+
+    for (uint32_t k = 0; k < count; k++)
+    {
+        uint32_t env = worker->index + k * config->num_threads;
+        GameState *state = game_pool_acquire(worker->arena);
+        uint64_t seed = game_seed_for(config->seed, env, 0);
+        if (!state || !game_init_into(state, config->num_players, config->variant, seed))
+            return false;
+
+        EnvSlot *slot = &pool->slots[env];
+        memset(slot, 0, sizeof(*slot));
+        slot->obs = worker->buffers + k * slot_bytes;
+        slot->mask = slot->obs + pool->obs_bytes;
+        pool->states[env] = state;
+    }
+    return true;
+}
+
+static void env_worker_run(EnvWorker *worker, uint32_t env, uint16_t action)
+{
+    GameEnvPool *pool = worker->pool;
+    const GameEnvPoolConfig *config = &pool->config;
+    GameState *state = pool->states[env];
+    EnvSlot *slot = &pool->slots[env];
+
+    bool redeal = false;
+    if (action == GAME_ENV_ACTION_RESET)
+    {
+        memset(&slot->result, 0, sizeof(slot->result));
+        slot->result.step.winner = -1;
+        redeal = slot->started;
+    }
+    else
+    {
+        // auto-reset is done here rather than by game_step_observe, so every
+        // re-deal follows the pool's game_seed_for(seed, env, episode) schedule
+        game_step_observe(state, action, config->flags & ~GAME_STEP_AUTO_RESET, config->obs_mode,
+                          config->obs_format, &slot->result, slot->obs, pool->obs_bytes, slot->mask,
+                          pool->mask_bytes);
+        redeal = slot->result.step.done && (config->flags & GAME_STEP_AUTO_RESET);
+    }
+
+    if (redeal)
+    {
+        uint64_t seed = game_seed_for(config->seed, env, ++slot->episode);
+        game_init_into(state, config->num_players, config->variant, seed);
+        slot->result.game_reset = true;
+        slot->result.reset_seed = seed;
+    }
+    if (redeal || action == GAME_ENV_ACTION_RESET)
+    {
+        game_get_observation_encoded(state, state->current_player, config->obs_mode, config->obs_format, slot->obs,
+                                     pool->obs_bytes);
+        game_get_legal_action_mask(state, slot->mask, pool->mask_bytes);
+    }
+
+    slot->started = true;
+    slot->player = state->current_player;
+}
+
+static void *env_worker_main(void *arg)
+{
+    EnvWorker *worker = arg;
+    GameEnvPool *pool = worker->pool;
+
+#ifdef __linux__
+    if (pool->config.pin_threads)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((int)(worker->index % (uint32_t)(cpus > 0 ? cpus : 1)), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+
+    if (!env_worker_init(worker))
+        atomic_store(&pool->init_failed, true);
+    sem_post(&pool->workers_ready);
+
+    for (;;)
+    {
+        env_sem_wait(&worker->tasks_ready);
+        if (atomic_load_explicit(&pool->stopping, memory_order_acquire))
+            break;
+
+        uint64_t task;
+        if (!env_queue_pop(&worker->tasks, &task))
+            continue;
+
+        uint32_t env = (uint32_t)(task >> 16);
+        env_worker_run(worker, env, (uint16_t)task);
+        env_queue_push(&pool->results, env);
+        sem_post(&pool->results_ready);
+    }
+
+    game_pool_destroy(worker->arena);
+    free(worker->buffers);
+    return NULL;
+}
+
+static void env_pool_free(GameEnvPool *pool)
+{
+    for (uint32_t t = 0; t < pool->num_started; t++)
+    {
+        sem_destroy(&pool->workers[t].tasks_ready);
+        free(pool->workers[t].tasks.cells);
+    }
+    sem_destroy(&pool->results_ready);
+    sem_destroy(&pool->workers_ready);
+    free(pool->results.cells);
+    free(pool->workers);
+    free(pool->states);
+    free(pool->slots);
+    free((void *)pool->in_flight);
+    free(pool);
+}
+
+GameEnvPool *game_env_pool_create(const GameEnvPoolConfig *config)
+{
+    if (!config || config->num_envs == 0 || config->num_envs > (UINT32_MAX >> 16) || config->num_threads == 0)
+        return NULL;
+    if (config->num_players < NUM_PLAYERS_MIN || config->num_players > NUM_PLAYERS_MAX)
+        return NULL;
+    if (game_observation_bytes(config->obs_format) == 0)
+        return NULL;
+
+    GameEnvPool *pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pool->config = *config;
+    if (pool->config.num_threads > ENV_POOL_MAX_THREADS)
+        pool->config.num_threads = ENV_POOL_MAX_THREADS;
+    if (pool->config.num_threads > pool->config.num_envs)
+        pool->config.num_threads = pool->config.num_envs;
+    pool->obs_bytes = game_observation_bytes(config->obs_format);
+    pool->mask_bytes = game_action_space_size();
+
+    uint32_t num_envs = pool->config.num_envs;
+    uint32_t num_threads = pool->config.num_threads;
+    pool->workers = calloc(num_threads, sizeof(EnvWorker));
+    pool->states = calloc(num_envs, sizeof(GameState *));
+    pool->slots = calloc(num_envs, sizeof(EnvSlot));
+    pool->in_flight = calloc(num_envs, sizeof(_Atomic uint8_t));
+    sem_init(&pool->results_ready, 0, 0);
+    sem_init(&pool->workers_ready, 0, 0);
+    if (!pool->workers || !pool->states || !pool->slots || !pool->in_flight ||
+        !env_queue_init(&pool->results, num_envs))
+    {
+        env_pool_free(pool);
+        return NULL;
+    }
+
+    for (uint32_t t = 0; t < num_threads; t++)
+    {
+        EnvWorker *worker = &pool->workers[t];
+        worker->pool = pool;
+        worker->index = t;
+        if (!env_queue_init(&worker->tasks, env_worker_count(pool, worker)))
+            break;
+        sem_init(&worker->tasks_ready, 0, 0);
+        if (pthread_create(&worker->thread, NULL, env_worker_main, worker) != 0)
+        {
+            sem_destroy(&worker->tasks_ready);
+            free(worker->tasks.cells);
+            break;
+        }
+        pool->num_started++;
+    }
+
+    for (uint32_t t = 0; t < pool->num_started; t++)
+        env_sem_wait(&pool->workers_ready);
+
+    if (pool->num_started < num_threads || atomic_load(&pool->init_failed))
+    {
+        game_env_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void game_env_pool_destroy(GameEnvPool *pool)
+{
+    if (!pool)
+        return;
+
+    atomic_store_explicit(&pool->stopping, true, memory_order_release);
+    for (uint32_t t = 0; t < pool->num_started; t++)
+        sem_post(&pool->workers[t].tasks_ready);
+    for (uint32_t t = 0; t < pool->num_started; t++)
+        pthread_join(pool->workers[t].thread, NULL);
+
+    env_pool_free(pool);
+}
+
+size_t game_env_pool_size(const GameEnvPool *pool)
+{
+    return pool ? pool->config.num_envs : 0;
+}
+
+size_t game_env_pool_send(GameEnvPool *pool, const uint32_t *env_ids, const uint16_t *actions, size_t count)
+{
+    if (!pool || !env_ids || !actions)
+        return 0;
+
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t env = env_ids[i];
+        if (env >= pool->config.num_envs)
+            continue;
+
+        uint8_t idle = 0;
+        if (!atomic_compare_exchange_strong(&pool->in_flight[env], &idle, 1))
+            continue;
+
+        atomic_fetch_add(&pool->outstanding, 1);
+        EnvWorker *worker = &pool->workers[env % pool->config.num_threads];
+        env_queue_push(&worker->tasks, (uint64_t)env << 16 | actions[i]);
+        sem_post(&worker->tasks_ready);
+        accepted++;
+    }
+    return accepted;
+}
+
+size_t game_env_pool_recv(GameEnvPool *pool, size_t batch_size, const GameEnvPoolBatch *out)
+{
+    if (!pool || !out)
+        return 0;
+
+    size_t outstanding = atomic_load(&pool->outstanding);
+    if (batch_size > outstanding)
+        batch_size = outstanding;
+
+    uint8_t *obs = out->obs;
+    size_t received = 0;
+    while (received < batch_size)
+    {
+        env_sem_wait(&pool->results_ready);
+
+        uint64_t value;
+        if (!env_queue_pop(&pool->results, &value))
+            continue;
+
+        uint32_t env = (uint32_t)value;
+        const EnvSlot *slot = &pool->slots[env];
+        if (out->env_ids)
+            out->env_ids[received] = env;
+        if (out->results)
+            out->results[received] = slot->result;
+        if (out->players)
+            out->players[received] = slot->player;
+        if (obs)
+            memcpy(obs + received * pool->obs_bytes, slot->obs, pool->obs_bytes);
+        if (out->masks)
+            memcpy(out->masks + received * pool->mask_bytes, slot->mask, pool->mask_bytes);
+
+        atomic_store(&pool->in_flight[env], 0);
+        atomic_fetch_sub(&pool->outstanding, 1);
+        received++;
+    }
+    return received;
+}
@@ -0,0 +1,433 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "poison_mcts.h"
+#include "poison_internal.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MCTS_NO_NODE (-1)
+#define MCTS_MAX_DEPTH 64
+#define MCTS_MAX_THREADS 64
+#define MCTS_REWARD_SCALE 65536.0
+#define MCTS_TIME_CHECK_INTERVAL 32
+
+// tree edges are keyed by (card type, cauldron) so they mean the same move
+// in every determinization, whatever hand slot the card sits in
+typedef struct
+{
+    _Atomic uint32_t visits;
+    _Atomic uint32_t availability;
+    _Atomic uint32_t virtual_loss;
+    _Atomic int64_t reward;
+    _Atomic int32_t first_child;
+    int32_t next_sibling;
+    uint8_t action;
+    uint8_t player;
+} MctsNode;
+
+typedef struct
+{
+    MctsNode *nodes;
+    uint32_t capacity;
+    _Atomic uint32_t size;
+    pthread_mutex_t expand_lock;
+} MctsTree;
+
+typedef struct
+{
+    const GameState *root;
+    const MctsConfig *config;
+    uint8_t player;
+    MctsTree *tree;
+    _Atomic uint64_t *iterations;
+    double deadline_ms;
+    GameRng rng;
+    uint64_t completed;
+} MctsWorker;
+
+static double mcts_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+void mcts_config_default(MctsConfig *config)
+{
+    if (!config)
+        return;
+
+    config->iterations = 10000;
+    config->time_budget_ms = 0;
+    config->num_threads = 1;
+    config->parallel_mode = MCTS_PARALLEL_ROOT;
+    config->obs_mode = GAME_OBS_PARTIAL;
+    config->void_colors = NULL;
+    config->exploration = 0.7f;
+    config->virtual_loss = 1;
+    config->max_nodes = 1u << 17;
+    config->seed = 0x2545F491u;
+}
+
+static bool mcts_tree_init(MctsTree *tree, uint32_t capacity)
+{
+    tree->nodes = malloc((size_t)capacity * sizeof(MctsNode));
+    if (!tree->nodes)
+        return false;
+
+    tree->capacity = capacity;
+    atomic_init(&tree->size, 1);
+    pthread_mutex_init(&tree->expand_lock, NULL);
+
+    MctsNode *root = &tree->nodes[0];
+    atomic_init(&root->visits, 0);
+    atomic_init(&root->availability, 0);
+    atomic_init(&root->virtual_loss, 0);
+    atomic_init(&root->reward, 0);
+    atomic_init(&root->first_child, MCTS_NO_NODE);
+    root->next_sibling = MCTS_NO_NODE;
+    root->action = 0;
+    root->player = 0;
+    return true;
+}
+
+static void mcts_tree_free(MctsTree *tree)
+{
+    pthread_mutex_destroy(&tree->expand_lock);
+    free(tree->nodes);
+}
+
+static int32_t mcts_find_child(const MctsTree *tree, int32_t parent, uint8_t action, uint8_t player)
+{
+    int32_t child = atomic_load_explicit(&tree->nodes[parent].first_child, memory_order_acquire);
+    while (child != MCTS_NO_NODE)
+    {
+        const MctsNode *node = &tree->nodes[child];
+        if (node->action == action && node->player == player)
+            return child;
+        child = node->next_sibling;
+    }
+    return MCTS_NO_NODE;
+}
+
+static int32_t mcts_add_child(MctsTree *tree, int32_t parent, uint8_t action, uint8_t player)
+{
+    pthread_mutex_lock(&tree->expand_lock);
+
+    int32_t existing = mcts_find_child(tree, parent, action, player);
+    if (existing != MCTS_NO_NODE)
+    {
+        pthread_mutex_unlock(&tree->expand_lock);
+        return existing;
+    }
+
+    uint32_t idx = atomic_load_explicit(&tree->size, memory_order_relaxed);
+    if (idx >= tree->capacity)
+    {
+        pthread_mutex_unlock(&tree->expand_lock);
+        return MCTS_NO_NODE;
+    }
+
+    MctsNode *node = &tree->nodes[idx];
+    MctsNode *parent_node = &tree->nodes[parent];
+    atomic_init(&node->visits, 0);
+    atomic_init(&node->availability, 0);
+    atomic_init(&node->virtual_loss, 0);
+    atomic_init(&node->reward, 0);
+    atomic_init(&node->first_child, MCTS_NO_NODE);
+    node->next_sibling = atomic_load_explicit(&parent_node->first_child, memory_order_relaxed);
+    node->action = action;
+    node->player = player;
+
+    atomic_store_explicit(&tree->size, idx + 1, memory_order_relaxed);
+    atomic_store_explicit(&parent_node->first_child, (int32_t)idx, memory_order_release);
+
+    pthread_mutex_unlock(&tree->expand_lock);
+    return (int32_t)idx;
+}
+
+static void mcts_round_utilities(GameState *state, double *out_utilities)
+{
+    int32_t scores[NUM_PLAYERS_MAX] = {0};
+    game_apply_round_scores(state, scores);
+
+    int32_t best = scores[0];
+    int32_t worst = scores[0];
+    for (uint8_t p = 1; p < state->num_players; p++)
+    {
+        if (scores[p] > best)
+            best = scores[p];
+        if (scores[p] < worst)
+            worst = scores[p];
+    }
+
+    for (uint8_t p = 0; p < state->num_players; p++)
+    {
+        out_utilities[p] = best == worst ? 0.5 : (double)(scores[p] - worst) / (double)(best - worst);
+    }
+}
+
+static bool mcts_round_active(const GameState *state)
+{
+    return !state->game_over && !state->round_scored;
+}
+
+static void mcts_iterate(MctsWorker *worker, GameState *det)
+{
+    const MctsConfig *config = worker->config;
+    MctsTree *tree = worker->tree;
+    int32_t path[MCTS_MAX_DEPTH];
+    uint8_t depth = 0;
+    int32_t node = 0;
+
+    if (config->obs_mode != GAME_OBS_PARTIAL)
+        game_copy_into(det, worker->root);
+    else if (!game_determinize(worker->root, worker->player, config->void_colors, &det, 1, &worker->rng))
+        game_determinize(worker->root, worker->player, NULL, &det, 1, &worker->rng);
+
+    // selection and expansion
+    while (mcts_round_active(det) && depth < MCTS_MAX_DEPTH)
+    {
+        uint8_t mover = det->current_player;
+        if (det->players[mover].hand_size == 0)
+        {
+            game_step_action(det, 0);
+            continue;
+        }
+
+        uint64_t legal;
+        game_get_typed_legal_action_bits(det, &legal);
+        uint64_t seen = 0;
+        for (int32_t child = atomic_load_explicit(&tree->nodes[node].first_child, memory_order_acquire);
+             child != MCTS_NO_NODE; child = tree->nodes[child].next_sibling)
+        {
+            const MctsNode *n = &tree->nodes[child];
+            if (n->player == mover)
+                seen |= 1ull << n->action;
+        }
+
+        uint64_t untried = legal & ~seen;
+        int32_t next = MCTS_NO_NODE;
+        uint8_t action = 0;
+
+        if (untried)
+        {
+            uint32_t pick = rng_bounded(&worker->rng, (uint32_t)__builtin_popcountll(untried));
+            while (pick--)
+            {
+                untried &= untried - 1;
+            }
+            action = (uint8_t)__builtin_ctzll(untried);
+            next = mcts_add_child(tree, node, action, mover);
+            if (next == MCTS_NO_NODE)
+                break;
+        }
+        else
+        {
+            double best_score = -INFINITY;
+            for (int32_t child = atomic_load_explicit(&tree->nodes[node].first_child, memory_order_acquire);
+                 child != MCTS_NO_NODE; child = tree->nodes[child].next_sibling)
+            {
+                MctsNode *n = &tree->nodes[child];
+                if (n->player != mover || !((legal >> n->action) & 1))
+                    continue;
+
+                uint32_t availability = atomic_fetch_add_explicit(&n->availability, 1, memory_order_relaxed) + 1;
+                uint32_t visits = atomic_load_explicit(&n->visits, memory_order_relaxed) +
+                                  atomic_load_explicit(&n->virtual_loss, memory_order_relaxed);
+                double score;
+                if (visits == 0)
+                {
+                    score = INFINITY;
+                }
+                else
+                {
+                    double mean = (double)atomic_load_explicit(&n->reward, memory_order_relaxed) /
+                                  MCTS_REWARD_SCALE / visits;
+                    score = mean + config->exploration * sqrt(log((double)availability) / visits);
+                }
+
+                if (score > best_score)
+                {
+                    best_score = score;
+                    next = child;
+                }
+            }
+            if (next == MCTS_NO_NODE)
+                break;
+            action = tree->nodes[next].action;
+        }
+
+        atomic_fetch_add_explicit(&tree->nodes[next].virtual_loss, config->virtual_loss, memory_order_relaxed);
+        path[depth++] = next;
+        node = next;
+        game_step_typed_action(det, action);
+
+        if (untried)
+            break;
+    }
+
+    // playout
+    while (mcts_round_active(det))
+    {
+        game_step_action(det, game_sample_legal_action(det, &worker->rng));
+    }
+
+    double utilities[NUM_PLAYERS_MAX];
+    mcts_round_utilities(det, utilities);
+
+    for (uint8_t i = 0; i < depth; i++)
+    {
+        MctsNode *n = &tree->nodes[path[i]];
+        atomic_fetch_add_explicit(&n->visits, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&n->reward, (int64_t)(utilities[n->player] * MCTS_REWARD_SCALE), memory_order_relaxed);
+        atomic_fetch_sub_explicit(&n->virtual_loss, config->virtual_loss, memory_order_relaxed);
+    }
+}
+
+static void *mcts_worker_run(void *arg)
+{
+    MctsWorker *worker = arg;
+    const MctsConfig *config = worker->config;
+    GameState *det = game_clone(worker->root);
+    if (!det)
+        return NULL;
+
+    while (true)
+    {
+        uint64_t ticket = atomic_fetch_add_explicit(worker->iterations, 1, memory_order_relaxed);
+        if (config->iterations && ticket >= config->iterations)
+            break;
+        if (config->time_budget_ms && (worker->completed % MCTS_TIME_CHECK_INTERVAL) == 0 &&
+            mcts_now_ms() >= worker->deadline_ms)
+            break;
+
+        mcts_iterate(worker, det);
+        worker->completed++;
+    }
+
+    game_destroy(det);
+    return NULL;
+}
+
+size_t mcts_search(const GameState *state, uint8_t player, const MctsConfig *config,
+                   float *out_visits, size_t out_len, MctsStats *stats)
+{
+    MctsConfig defaults;
+    if (!config)
+    {
+        mcts_config_default(&defaults);
+        config = &defaults;
+    }
+
+    if (!state || !out_visits)
+        return 0;
+    const uint16_t action_space = game_action_space_size();
+    if (out_len < action_space)
+        return 0;
+    if (config->iterations == 0 && config->time_budget_ms == 0)
+        return 0;
+    if (config->max_nodes < 2 || player != state->current_player)
+        return 0;
+    if (!mcts_round_active(state) || state->players[player].hand_size == 0)
+        return 0;
+
+    uint8_t num_threads = config->num_threads ? config->num_threads : 1;
+    if (num_threads > MCTS_MAX_THREADS)
+        num_threads = MCTS_MAX_THREADS;
+    uint8_t num_trees = config->parallel_mode == MCTS_PARALLEL_ROOT ? num_threads : 1;
+
+    MctsTree trees[MCTS_MAX_THREADS];
+    MctsWorker workers[MCTS_MAX_THREADS];
+    pthread_t threads[MCTS_MAX_THREADS];
+    _Atomic uint64_t iterations;
+    atomic_init(&iterations, 0);
+
+    uint8_t trees_ready = 0;
+    for (; trees_ready < num_trees; trees_ready++)
+    {
+        if (!mcts_tree_init(&trees[trees_ready], config->max_nodes))
+            break;
+    }
+    if (trees_ready < num_trees)
+    {
+        for (uint8_t i = 0; i < trees_ready; i++)
+        {
+            mcts_tree_free(&trees[i]);
+        }
+        return 0;
+    }
+
+    double start_ms = mcts_now_ms();
+    for (uint8_t i = 0; i < num_threads; i++)
+    {
+        MctsWorker *worker = &workers[i];
+        worker->root = state;
+        worker->config = config;
+        worker->player = player;
+        worker->tree = &trees[num_trees == 1 ? 0 : i];
+        worker->iterations = &iterations;
+        worker->deadline_ms = start_ms + config->time_budget_ms;
+        rng_seed(&worker->rng, config->seed, i + 1); // one stream per worker
+        worker->completed = 0;
+    }
+
+    uint8_t started = 1;
+    for (; started < num_threads; started++)
+    {
+        if (pthread_create(&threads[started], NULL, mcts_worker_run, &workers[started]) != 0)
+            break;
+    }
+    mcts_worker_run(&workers[0]);
+    for (uint8_t i = 1; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed_ms = mcts_now_ms() - start_ms;
+
+    double typed_visits[TYPED_ACTIONS] = {0};
+    double total = 0.0;
+    uint64_t nodes = 0;
+    for (uint8_t t = 0; t < num_trees; t++)
+    {
+        const MctsTree *tree = &trees[t];
+        for (int32_t child = atomic_load(&tree->nodes[0].first_child); child != MCTS_NO_NODE;
+             child = tree->nodes[child].next_sibling)
+        {
+            const MctsNode *n = &tree->nodes[child];
+            uint32_t visits = atomic_load(&n->visits);
+            typed_visits[n->action] += visits;
+            total += visits;
+        }
+        nodes += atomic_load(&tree->size);
+        mcts_tree_free(&trees[t]);
+    }
+
+    memset(out_visits, 0, action_space * sizeof(float));
+    for (uint8_t a = 0; a < TYPED_ACTIONS; a++)
+    {
+        // root children are types in the mover's own hand, which every determinization keeps
+        if (typed_visits[a] > 0.0)
+            out_visits[game_typed_to_action(state, a)] += (float)(typed_visits[a] / total);
+    }
+
+    if (stats)
+    {
+        uint64_t completed = 0;
+        for (uint8_t i = 0; i < started; i++)
+        {
+            completed += workers[i].completed;
+        }
+        stats->iterations = completed;
+        stats->nodes = nodes;
+        stats->elapsed_ms = elapsed_ms;
+        stats->playouts_per_sec = elapsed_ms > 0.0 ? (double)completed * 1000.0 / elapsed_ms : 0.0;
+    }
+
+    return action_space;
+}
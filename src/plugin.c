@@ -0,0 +1,187 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "poison_plugin.h"
+#include "poison_internal.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct PolicyPlugin
+{
+    void *handle;
+    const PolicyPluginApi *api;
+    void *instance;
+    pthread_mutex_t lock; // held around act unless the plugin is thread-safe
+    _Atomic uint64_t illegal_actions;
+};
+
+static void plugin_error(char *error, size_t error_len, const char *what, const char *detail)
+{
+    if (error && error_len)
+        snprintf(error, error_len, "%s%s%s", what, detail ? ": " : "", detail ? detail : "");
+}
+
+PolicyPlugin *policy_plugin_load(const char *spec, char *error, size_t error_len)
+{
+    if (!spec)
+        return NULL;
+
+    size_t path_len = strcspn(spec, ":");
+    char *path = malloc(path_len + 1);
+    PolicyPlugin *plugin = calloc(1, sizeof(*plugin));
+    if (!path || !plugin)
+    {
+        plugin_error(error, error_len, "out of memory", NULL);
+        free(plugin);
+        free(path);
+        return NULL;
+    }
+    memcpy(path, spec, path_len);
+    path[path_len] = '\0';
+    const char *args = spec[path_len] == ':' ? spec + path_len + 1 : "";
+
+    plugin->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    free(path);
+    if (!plugin->handle)
+    {
+        plugin_error(error, error_len, "dlopen failed", dlerror());
+        free(plugin);
+        return NULL;
+    }
+
+    PolicyPluginEntry entry = (PolicyPluginEntry)dlsym(plugin->handle, POLICY_PLUGIN_SYMBOL);
+    plugin->api = entry ? entry() : NULL;
+    if (!plugin->api || plugin->api->abi_version != POLICY_PLUGIN_ABI_VERSION || !plugin->api->act)
+    {
+        plugin_error(error, error_len, entry ? "unsupported plugin ABI" : "missing " POLICY_PLUGIN_SYMBOL, NULL);
+        dlclose(plugin->handle);
+        free(plugin);
+        return NULL;
+    }
+
+    if (plugin->api->init)
+    {
+        plugin->instance = plugin->api->init(args);
+        if (!plugin->instance)
+        {
+            plugin_error(error, error_len, "plugin init failed", args);
+            dlclose(plugin->handle);
+            free(plugin);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_init(&plugin->lock, NULL);
+    atomic_init(&plugin->illegal_actions, 0);
+    return plugin;
+}
+
+void policy_plugin_unload(PolicyPlugin *plugin)
+{
+    if (!plugin)
+        return;
+
+    if (plugin->api->destroy)
+        plugin->api->destroy(plugin->instance);
+    pthread_mutex_destroy(&plugin->lock);
+    dlclose(plugin->handle);
+    free(plugin);
+}
+
+const char *policy_plugin_name(const PolicyPlugin *plugin)
+{
+    if (!plugin)
+        return NULL;
+    return plugin->api->name ? plugin->api->name : "plugin";
+}
+
+uint64_t policy_plugin_illegal_actions(const PolicyPlugin *plugin)
+{
+    return plugin ? atomic_load(&plugin->illegal_actions) : 0;
+}
+
+bool policy_plugin_act(PolicyPlugin *plugin, const GameState *const *states, size_t count, GameRng *rng,
+                       uint16_t *out_actions)
+{
+    if (!plugin || !states || !out_actions || !rng)
+        return false;
+    if (count == 0)
+        return true;
+
+    uint32_t flags = plugin->api->flags;
+    size_t obs_size = game_observation_size();
+    size_t mask_size = game_action_space_size();
+    float *obs = NULL;
+    uint8_t *masks = NULL;
+
+    // one allocation per batch; callers amortise it by passing many states
+    if (flags & POLICY_PLUGIN_WANTS_OBS)
+    {
+        obs = malloc(count * obs_size * sizeof(*obs));
+        if (!obs)
+            return false;
+        for (size_t i = 0; i < count; i++)
+            game_get_observation(states[i], game_get_current_player(states[i]), GAME_OBS_PARTIAL,
+                                 obs + i * obs_size, obs_size);
+    }
+    if (flags & POLICY_PLUGIN_WANTS_MASK)
+    {
+        masks = malloc(count * mask_size);
+        if (!masks)
+        {
+            free(obs);
+            return false;
+        }
+        for (size_t i = 0; i < count; i++)
+            game_get_legal_action_mask(states[i], masks + i * mask_size, mask_size);
+    }
+
+    PolicyPluginBatch batch = {count, states, obs, obs_size, masks, mask_size, rng};
+    bool serial = !(flags & POLICY_PLUGIN_THREAD_SAFE);
+    if (serial)
+        pthread_mutex_lock(&plugin->lock);
+    bool ok = plugin->api->act(plugin->instance, &batch, out_actions);
+    if (serial)
+        pthread_mutex_unlock(&plugin->lock);
+
+    uint64_t illegal = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t legal[LEGAL_ACTION_WORDS];
+        if (!game_get_legal_action_bits(states[i], legal, LEGAL_ACTION_WORDS))
+            continue;
+        uint16_t action = out_actions[i];
+        if (!ok || action >= mask_size || !(legal[action / 64] & (1ull << (action % 64))))
+        {
+            out_actions[i] = game_sample_legal_action(states[i], rng);
+            illegal++;
+        }
+    }
+    if (illegal)
+        atomic_fetch_add(&plugin->illegal_actions, illegal);
+
+    free(masks);
+    free(obs);
+    return ok;
+}
+
+static void plugin_tournament_act(void *ctx, const GameState *const *states, size_t count, GameRng *rng,
+                                  uint16_t *out_actions)
+{
+    policy_plugin_act(ctx, states, count, rng, out_actions);
+}
+
+void policy_plugin_entrant(PolicyPlugin *plugin, TournamentEntrant *out)
+{
+    if (!plugin || !out)
+        return;
+
+    out->name = policy_plugin_name(plugin);
+    out->policy = POLICY_RANDOM;
+    out->act = plugin_tournament_act;
+    out->ctx = plugin;
+}
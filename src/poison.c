@@ -1,56 +1,72 @@
-#include "poison.h"
+#include "poison_internal.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-#define TOTAL_CARDS 50
-#define NUM_POISON_CARDS 8
-#define NUM_COLORS 3
-#define NUM_POTION_VALUES 5
-#define NUM_CARD_TYPES (NUM_COLORS * NUM_POTION_VALUES + 1)
-#define HAND_SIZE_DRAW 5
-
-static const uint8_t POTION_VALUES[NUM_POTION_VALUES] = {1, 2, 4, 5, 7};
+const Card CARD_TYPES[NUM_CARD_TYPES] = {
+    {CARD_TYPE_POTION, COLOR_RED, 1},
+    {CARD_TYPE_POTION, COLOR_RED, 2},
+    {CARD_TYPE_POTION, COLOR_RED, 4},
+    {CARD_TYPE_POTION, COLOR_RED, 5},
+    {CARD_TYPE_POTION, COLOR_RED, 7},
+    {CARD_TYPE_POTION, COLOR_BLUE, 1},
+    {CARD_TYPE_POTION, COLOR_BLUE, 2},
+    {CARD_TYPE_POTION, COLOR_BLUE, 4},
+    {CARD_TYPE_POTION, COLOR_BLUE, 5},
+    {CARD_TYPE_POTION, COLOR_BLUE, 7},
+    {CARD_TYPE_POTION, COLOR_PURPLE, 1},
+    {CARD_TYPE_POTION, COLOR_PURPLE, 2},
+    {CARD_TYPE_POTION, COLOR_PURPLE, 4},
+    {CARD_TYPE_POTION, COLOR_PURPLE, 5},
+    {CARD_TYPE_POTION, COLOR_PURPLE, 7},
+    {CARD_TYPE_POISON, COLOR_NONE, 4},
+};
 
-typedef struct
-{
-    Card cards[TOTAL_CARDS];
-    uint8_t num_cards;
-    uint8_t total_value;
-    Color color;
-} Cauldron;
+const uint8_t DECK_TYPE_COUNTS[NUM_CARD_TYPES] = {
+    3, 3, 2, 3, 3,
+    3, 3, 2, 3, 3,
+    3, 3, 2, 3, 3,
+    NUM_POISON_CARDS,
+};
 
 typedef struct
 {
-    Card hand[TOTAL_CARDS];
-    uint8_t hand_size;
-    Card collected[TOTAL_CARDS];
-    uint8_t collected_size;
-    int32_t score;
-} Player;
+    uint8_t card_index;
+    uint8_t cauldron_index;
+} Action;
 
-struct GameState
+// Zobrist features; hands, piles and cauldrons are hashed as multisets, one
+// key per (owner, type, k-th copy), and the undealt deck by (position, type)
+enum
 {
-    Player players[NUM_PLAYERS_MAX];
-    Cauldron cauldrons[NUM_CAULDRONS];
-    uint8_t num_players;
-    uint8_t current_player;
-    uint8_t dealer;
-    uint8_t round;
-    bool game_over;
-    bool round_scored;
-    GameVariant variant;
-    Card deck[TOTAL_CARDS];
-    uint8_t deck_size;
-    uint8_t deck_pos;
-    uint32_t rng_state;
+    ZOBRIST_HAND = 1,
+    ZOBRIST_COLLECTED,
+    ZOBRIST_CAULDRON,
+    ZOBRIST_DECK,
+    ZOBRIST_TURN,
+    ZOBRIST_SCORE,
+    ZOBRIST_ROUND,
+    ZOBRIST_FLAGS
 };
 
+// everything game_step_action may change, captured before the step
 typedef struct
 {
+    Cauldron cauldron;
+    int32_t scores[NUM_PLAYERS_MAX];
+    uint8_t current_player;
+    uint8_t deck_pos;
     uint8_t card_index;
+    uint8_t card_type;
     uint8_t cauldron_index;
-} Action;
+    bool played;
+    bool overflowed;
+    bool round_scored;
+    bool game_over;
+    uint64_t hash;
+} UndoRecord;
+
+_Static_assert(sizeof(UndoRecord) <= sizeof(GameUndo), "GameUndo too small for UndoRecord");
 
 static uint16_t action_space_size(void)
 {
@@ -59,20 +75,7 @@ static uint16_t action_space_size(void)
 
 static size_t observation_size(void)
 {
-    return 6 + NUM_PLAYERS_MAX * (3 + 2 * NUM_CARD_TYPES) +
-           NUM_CAULDRONS * (3 + NUM_CARD_TYPES);
-}
-
-static int8_t game_potion_value_index(uint8_t value)
-{
-    for (uint8_t i = 0; i < NUM_POTION_VALUES; i++)
-    {
-        if (POTION_VALUES[i] == value)
-        {
-            return (int8_t)i;
-        }
-    }
-    return -1;
+    return OBS_SIZE;
 }
 
 static uint8_t game_color_index(Color color)
@@ -90,111 +93,256 @@ static uint8_t game_color_index(Color color)
     }
 }
 
-static uint8_t game_card_type_index(const Card *card)
+// keys are derived on the fly with the splitmix64 finaliser, so there is no
+// table to initialise or share between threads
+static uint64_t zobrist_key(uint32_t feature, uint32_t a, uint32_t b, uint32_t c)
 {
-    if (card->type == CARD_TYPE_POISON)
-        return (uint8_t)(NUM_CARD_TYPES - 1);
-
-    int8_t value_idx = game_potion_value_index(card->value);
-    if (value_idx < 0)
-        return 0;
+    uint64_t x = ((uint64_t)feature << 56) ^ ((uint64_t)a << 40) ^ ((uint64_t)b << 32) ^ c;
 
-    return (uint8_t)(game_color_index(card->color) * NUM_POTION_VALUES + value_idx);
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
 }
 
-static void game_count_cards(const Card *cards, uint8_t count, uint8_t *out_counts)
+static uint64_t zobrist_counts(uint32_t feature, uint8_t owner, const uint8_t *counts)
 {
-    memset(out_counts, 0, NUM_CARD_TYPES * sizeof(uint8_t));
-    for (uint8_t i = 0; i < count; i++)
+    uint64_t hash = 0;
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
     {
-        uint8_t idx = game_card_type_index(&cards[i]);
-        if (idx < NUM_CARD_TYPES)
+        for (uint8_t k = 1; k <= counts[t]; k++)
         {
-            out_counts[idx]++;
+            hash ^= zobrist_key(feature, owner, t, k);
         }
     }
+    return hash;
 }
 
-static uint32_t rng_next(uint32_t *state)
+static uint64_t zobrist_flags(const GameState *state)
 {
-    uint32_t x = *state;
-    if (x == 0)
-        x = 0x6D2B79F5u;
-
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
-    *state = x;
-    return x;
+    return zobrist_key(ZOBRIST_FLAGS, state->round_scored, state->game_over, 0);
 }
 
-static void deck_create(Card *deck)
+static uint64_t game_compute_hash(const GameState *state)
 {
-    uint8_t idx = 0;
-
-    const Color colors[] = {COLOR_BLUE, COLOR_RED, COLOR_PURPLE};
-    const uint8_t values[] = {1, 2, 5, 7};
+    uint64_t hash = zobrist_key(ZOBRIST_TURN, state->current_player, 0, 0) ^
+                    zobrist_key(ZOBRIST_ROUND, state->round, state->dealer, 0) ^
+                    zobrist_flags(state);
 
-    for (uint8_t i = 0; i < (uint8_t)(sizeof(colors) / sizeof(colors[0])); i++)
+    for (uint8_t p = 0; p < state->num_players; p++)
     {
-        for (uint8_t j = 0; j < (uint8_t)(sizeof(values) / sizeof(values[0])); j++)
-        {
-            for (uint8_t k = 0; k < 3; k++)
-            {
-                deck[idx].type = CARD_TYPE_POTION;
-                deck[idx].color = colors[i];
-                deck[idx].value = values[j];
-                idx++;
-            }
-        }
+        const Player *player = &state->players[p];
+        hash ^= zobrist_counts(ZOBRIST_HAND, p, player->hand_counts);
+        hash ^= zobrist_counts(ZOBRIST_COLLECTED, p, player->collected_counts);
+        hash ^= zobrist_key(ZOBRIST_SCORE, p, 0, (uint32_t)player->score);
+    }
 
-        for (uint8_t k = 0; k < 2; k++)
-        {
-            deck[idx].type = CARD_TYPE_POTION;
-            deck[idx].color = colors[i];
-            deck[idx].value = 4;
-            idx++;
-        }
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+    {
+        hash ^= zobrist_counts(ZOBRIST_CAULDRON, c, state->cauldrons[c].counts);
     }
 
-    for (uint8_t i = 0; i < NUM_POISON_CARDS; i++)
+    for (uint8_t i = state->deck_pos; i < state->deck_size; i++)
     {
-        deck[idx].type = CARD_TYPE_POISON;
-        deck[idx].color = COLOR_NONE;
-        deck[idx].value = 4;
-        idx++;
+        hash ^= zobrist_key(ZOBRIST_DECK, i, state->deck[i], 0);
     }
+
+    return hash;
 }
 
-static void deck_shuffle(Card *deck, uint8_t size, uint32_t *rng_state)
+static void game_set_flags(GameState *state, bool round_scored, bool game_over)
 {
-    if (size < 2)
-        return;
-    if (!rng_state)
+    state->hash ^= zobrist_flags(state);
+    state->round_scored = round_scored;
+    state->game_over = game_over;
+    state->hash ^= zobrist_flags(state);
+}
+
+void game_rng_seed(GameRng *rng, uint64_t seed, uint64_t stream)
+{
+    if (rng)
+        rng_seed(rng, seed, stream);
+}
+
+uint32_t game_rng_next(GameRng *rng)
+{
+    return rng ? rng_next(rng) : 0;
+}
+
+uint64_t game_rng_next64(GameRng *rng)
+{
+    return rng ? rng_next64(rng) : 0;
+}
+
+uint32_t game_rng_bounded(GameRng *rng, uint32_t bound)
+{
+    return rng && bound ? rng_bounded(rng, bound) : 0;
+}
+
+// composes delta LCG steps by repeated squaring (Brown, "Random number
+// generation with arbitrary strides")
+void game_rng_advance(GameRng *rng, uint64_t delta)
+{
+    if (!rng)
         return;
 
-    for (uint8_t i = size - 1; i > 0; i--)
+    uint64_t acc_mult = 1;
+    uint64_t acc_plus = 0;
+    uint64_t cur_mult = RNG_MULTIPLIER;
+    uint64_t cur_plus = rng->inc;
+    while (delta)
+    {
+        if (delta & 1)
+        {
+            acc_mult *= cur_mult;
+            acc_plus = acc_plus * cur_mult + cur_plus;
+        }
+        cur_plus = (cur_mult + 1) * cur_plus;
+        cur_mult *= cur_mult;
+        delta >>= 1;
+    }
+    rng->state = acc_mult * rng->state + acc_plus;
+}
+
+GameRng game_rng_split(GameRng *rng)
+{
+    GameRng child = {0};
+    if (!rng)
+        return child;
+
+    uint64_t seed = rng_next64(rng);
+    rng_seed(&child, seed, rng_next64(rng));
+    return child;
+}
+
+uint64_t game_seed_for(uint64_t base, uint64_t env_id, uint64_t episode)
+{
+    GameRng rng;
+    rng_seed(&rng, base, env_id);
+    game_rng_advance(&rng, 2 * episode);
+    return rng_next64(&rng);
+}
+
+// the full deck in type order. Every deal is a prefix of a partial shuffle of
+// it, so 3-player games draw their 38 cards at random without a compaction pass
+static const uint8_t DECK_TEMPLATE[TOTAL_CARDS] = {
+    0,  0,  0,  1,  1,  1,  2,  2,  3,  3,  3,  4,  4,  4,
+    5,  5,  5,  6,  6,  6,  7,  7,  8,  8,  8,  9,  9,  9,
+    10, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 14, 14, 14,
+    15, 15, 15, 15, 15, 15, 15, 15,
+};
+
+// cards in play per player count
+static const uint8_t DECK_SIZES[NUM_PLAYERS_MAX + 1] = {0, 0, 0, 38, TOTAL_CARDS, TOTAL_CARDS, TOTAL_CARDS};
+
+// partial Fisher-Yates: afterwards deck[0, used) is a uniform random ordered
+// sample of deck[0, size), and only those positions cost a draw
+static void deck_shuffle(uint8_t *deck, uint8_t size, uint8_t used, GameRng *rng)
+{
+    if (used >= size)
+        used = size - 1;
+
+    for (uint8_t i = 0; i < used; i++)
     {
-        uint8_t j = (uint8_t)(rng_next(rng_state) % (i + 1));
+        uint8_t j = (uint8_t)(i + rng_bounded(rng, (uint32_t)(size - i)));
 
-        Card temp = deck[i];
+        uint8_t temp = deck[i];
         deck[i] = deck[j];
         deck[j] = temp;
     }
 }
 
-static void deck_deal(GameState *state)
+static void player_add_hand_card(GameState *state, uint8_t player_idx, uint8_t type)
 {
-    if (!state)
-        return;
+    Player *player = &state->players[player_idx];
+    int16_t *features = state->player_features[player_idx];
+
+    player->hand[player->hand_size++] = type;
+    player->hand_counts[type]++;
+    state->cards_in_hands++;
+    state->hash ^= zobrist_key(ZOBRIST_HAND, player_idx, type, player->hand_counts[type]);
+
+    features[FEAT_HAND_SIZE]++;
+    features[FEAT_HAND_COUNTS + type]++;
+}
+
+static void game_draw_card(GameState *state, uint8_t player_idx)
+{
+    uint8_t type = state->deck[state->deck_pos];
+    state->hash ^= zobrist_key(ZOBRIST_DECK, state->deck_pos, type, 0);
+    state->deck_pos++;
+    player_add_hand_card(state, player_idx, type);
+}
+
+static void game_set_current_player(GameState *state, uint8_t player_idx)
+{
+    state->hash ^= zobrist_key(ZOBRIST_TURN, state->current_player, 0, 0) ^
+                   zobrist_key(ZOBRIST_TURN, player_idx, 0, 0);
+    state->current_player = player_idx;
+}
+
+void game_set_player_hand(GameState *state, uint8_t player_idx, const uint8_t *types, uint8_t count)
+{
+    Player *player = &state->players[player_idx];
+    int16_t *features = state->player_features[player_idx];
+
+    state->hash ^= zobrist_counts(ZOBRIST_HAND, player_idx, player->hand_counts);
+    state->cards_in_hands -= player->hand_size;
+    player->hand_size = 0;
+    memset(player->hand_counts, 0, sizeof(player->hand_counts));
+    features[FEAT_HAND_SIZE] = 0;
+    memset(&features[FEAT_HAND_COUNTS], 0, NUM_CARD_TYPES * sizeof(int16_t));
+
+    if (count > HAND_CAPACITY)
+        count = HAND_CAPACITY;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        player_add_hand_card(state, player_idx, types[i]);
+    }
+}
+
+static void cauldron_sync_features(GameState *state, uint8_t cauldron_idx)
+{
+    const Cauldron *cauldron = &state->cauldrons[cauldron_idx];
+    int16_t *features = state->cauldron_features[cauldron_idx];
+
+    features[FEAT_CAULDRON_TOTAL] = cauldron->total_value;
+    features[FEAT_CAULDRON_NUM_CARDS] = cauldron->num_cards;
+    features[FEAT_CAULDRON_COLOR] = cauldron->color;
+    for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
+    {
+        features[FEAT_CAULDRON_COUNTS + i] = cauldron->counts[i];
+    }
+}
+
+// deals count cards round-robin from the dealer's left straight into the hands.
+// Deck and hand keys are not updated: callers recompute the hash afterwards.
+static void deck_deal(GameState *state, uint8_t count)
+{
+    uint8_t end = state->deck_pos + count;
+    if (end > state->deck_size)
+        end = state->deck_size;
+
+    uint8_t player_idx = state->dealer + 1;
+    if (player_idx == state->num_players)
+        player_idx = 0;
 
-    uint8_t player_idx = (state->dealer + 1) % state->num_players;
-    while (state->deck_pos < state->deck_size)
+    for (uint8_t i = state->deck_pos; i < end; i++)
     {
+        uint8_t type = state->deck[i];
         Player *player = &state->players[player_idx];
-        player->hand[player->hand_size++] = state->deck[state->deck_pos++];
-        player_idx = (player_idx + 1) % state->num_players;
+        player->hand[player->hand_size++] = type;
+        player->hand_counts[type]++;
+        state->player_features[player_idx][FEAT_HAND_COUNTS + type]++;
+
+        if (++player_idx == state->num_players)
+            player_idx = 0;
     }
+
+    for (uint8_t p = 0; p < state->num_players; p++)
+        state->player_features[p][FEAT_HAND_SIZE] = state->players[p].hand_size;
+    state->cards_in_hands += (uint8_t)(end - state->deck_pos);
+    state->deck_pos = end;
 }
 
 static uint8_t game_max_rounds(const GameState *state)
@@ -208,57 +356,105 @@ static uint8_t game_max_rounds(const GameState *state)
 
 static void game_prepare_deck(GameState *state)
 {
-    deck_create(state->deck);
-    deck_shuffle(state->deck, TOTAL_CARDS, &state->rng_state);
+    uint8_t size = DECK_SIZES[state->num_players];
 
-    state->deck_size = TOTAL_CARDS;
+    memcpy(state->deck, DECK_TEMPLATE, TOTAL_CARDS);
+    deck_shuffle(state->deck, TOTAL_CARDS, size, &state->rng);
+    state->deck_size = size;
     state->deck_pos = 0;
 
-    if (state->num_players != 3)
-        return;
+    if (state->variant == GAME_VARIANT_DRAW)
+        deck_deal(state, (uint8_t)(HAND_SIZE_DRAW * state->num_players));
+    else
+        deck_deal(state, size);
+}
 
-    uint8_t write_idx = 0;
-    for (uint8_t read_idx = 0; read_idx < TOTAL_CARDS; read_idx++)
+static void game_clear_table(GameState *state)
+{
+    for (uint8_t i = 0; i < state->num_players; i++)
     {
-        if ((read_idx % 4) == 3)
-            continue;
-        state->deck[write_idx++] = state->deck[read_idx];
+        Player *player = &state->players[i];
+        memset(player->hand_counts, 0, sizeof(player->hand_counts));
+        memset(player->collected_counts, 0, sizeof(player->collected_counts));
+        player->hand_size = 0;
+        player->collected_size = 0;
     }
 
-    state->deck_size = write_idx;
-}
-
-static void game_deal_draw_variant(GameState *state)
-{
-    uint8_t player_idx = (state->dealer + 1) % state->num_players;
-    uint8_t cards_to_deal = (uint8_t)(HAND_SIZE_DRAW * state->num_players);
+    memset(state->cauldrons, 0, sizeof(state->cauldrons));
+    state->cards_in_hands = 0;
 
-    for (uint8_t i = 0; i < cards_to_deal && state->deck_pos < state->deck_size; i++)
+    for (uint8_t i = 0; i < state->num_players; i++)
     {
-        Player *player = &state->players[player_idx];
-        player->hand[player->hand_size++] = state->deck[state->deck_pos++];
-        player_idx = (player_idx + 1) % state->num_players;
+        int16_t score = state->player_features[i][FEAT_SCORE];
+        memset(state->player_features[i], 0, sizeof(state->player_features[i]));
+        state->player_features[i][FEAT_SCORE] = score;
     }
+    memset(state->cauldron_features, 0, sizeof(state->cauldron_features));
+}
+
+static void game_setup(GameState *state, uint8_t num_players, GameVariant variant, uint64_t seed)
+{
+    memset(state, 0, sizeof(*state));
+    state->num_players = num_players;
+    state->variant = variant;
+    rng_seed(&state->rng, seed, 0);
+    game_reset(state);
 }
 
-GameState *game_init(uint8_t num_players, GameVariant variant, uint32_t seed)
+GameState *game_init(uint8_t num_players, GameVariant variant, uint64_t seed)
 {
+    GAME_PROFILE_SCOPE(GAME_PROFILE_INIT);
+
     if (num_players < NUM_PLAYERS_MIN || num_players > NUM_PLAYERS_MAX)
         return NULL;
 
-    GameState *state = malloc(sizeof(*state));
+    GameState *state = aligned_alloc(CACHE_LINE_SIZE, sizeof(*state));
     if (!state)
         return NULL;
 
-    memset(state, 0, sizeof(*state));
-    state->num_players = num_players;
-    state->variant = variant;
-    state->rng_state = seed ? seed : 0x9E3779B9u;
-    game_reset(state);
+    game_setup(state, num_players, variant, seed);
 
     return state;
 }
 
+bool game_init_into(GameState *state, uint8_t num_players, GameVariant variant, uint64_t seed)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_INIT);
+
+    if (!state)
+        return false;
+    if (num_players < NUM_PLAYERS_MIN || num_players > NUM_PLAYERS_MAX)
+        return false;
+
+    game_setup(state, num_players, variant, seed);
+    return true;
+}
+
+GameState *game_clone(const GameState *state)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_CLONE);
+
+    if (!state)
+        return NULL;
+
+    GameState *clone = aligned_alloc(CACHE_LINE_SIZE, sizeof(*clone));
+    if (!clone)
+        return NULL;
+
+    memcpy(clone, state, sizeof(*clone));
+    return clone;
+}
+
+void game_copy_into(GameState *dst, const GameState *src)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_COPY);
+
+    if (!dst || !src || dst == src)
+        return;
+
+    memcpy(dst, src, sizeof(*dst));
+}
+
 void game_destroy(GameState *state)
 {
     if (state)
@@ -269,21 +465,16 @@ void game_destroy(GameState *state)
 
 void game_reset(GameState *state)
 {
+    GAME_PROFILE_SCOPE(GAME_PROFILE_RESET);
+
     if (!state)
         return;
 
+    game_clear_table(state);
     for (uint8_t i = 0; i < state->num_players; i++)
     {
-        state->players[i].hand_size = 0;
-        state->players[i].collected_size = 0;
         state->players[i].score = 0;
-    }
-
-    for (uint8_t i = 0; i < NUM_CAULDRONS; i++)
-    {
-        state->cauldrons[i].num_cards = 0;
-        state->cauldrons[i].total_value = 0;
-        state->cauldrons[i].color = COLOR_NONE;
+        state->player_features[i][FEAT_SCORE] = 0;
     }
 
     state->dealer = 0;
@@ -293,16 +484,8 @@ void game_reset(GameState *state)
 
     game_prepare_deck(state);
 
-    if (state->variant == GAME_VARIANT_DRAW)
-    {
-        game_deal_draw_variant(state);
-    }
-    else
-    {
-        deck_deal(state);
-    }
-
     state->current_player = (state->dealer + 1) % state->num_players;
+    state->hash = game_compute_hash(state);
 }
 
 static bool game_is_action_legal(const GameState *state, const Action *action)
@@ -317,7 +500,7 @@ static bool game_is_action_legal(const GameState *state, const Action *action)
     if (action->cauldron_index >= NUM_CAULDRONS)
         return false;
 
-    const Card *card = &player->hand[action->card_index];
+    const Card *card = &CARD_TYPES[player->hand[action->card_index]];
     const Cauldron *cauldron = &state->cauldrons[action->cauldron_index];
 
     if (card->type == CARD_TYPE_POISON)
@@ -343,61 +526,89 @@ static float game_step(GameState *state, const Action *action)
     if (!game_is_action_legal(state, action))
         return 0.0f;
 
-    Player *player = &state->players[state->current_player];
-    Card card = player->hand[action->card_index];
+    uint8_t player_idx = state->current_player;
+    Player *player = &state->players[player_idx];
+    int16_t *features = state->player_features[player_idx];
+    uint8_t type = player->hand[action->card_index];
+    const Card *card = &CARD_TYPES[type];
 
-    for (uint8_t i = action->card_index; i < player->hand_size - 1; i++)
-    {
-        player->hand[i] = player->hand[i + 1];
-    }
+    state->hash ^= zobrist_key(ZOBRIST_HAND, player_idx, type, player->hand_counts[type]);
+    memmove(&player->hand[action->card_index], &player->hand[action->card_index + 1],
+            (size_t)(player->hand_size - action->card_index - 1));
     player->hand_size--;
+    player->hand_counts[type]--;
+    state->cards_in_hands--;
+    features[FEAT_HAND_SIZE]--;
+    features[FEAT_HAND_COUNTS + type]--;
 
     Cauldron *cauldron = &state->cauldrons[action->cauldron_index];
+    int16_t *cauldron_features = state->cauldron_features[action->cauldron_index];
 
-    cauldron->cards[cauldron->num_cards++] = card;
-    cauldron->total_value += card.value;
+    cauldron->cards[cauldron->num_cards++] = type;
+    cauldron->counts[type]++;
+    cauldron->total_value += card->value;
+    state->hash ^= zobrist_key(ZOBRIST_CAULDRON, action->cauldron_index, type, cauldron->counts[type]);
 
-    if (cauldron->color == COLOR_NONE && card.type == CARD_TYPE_POTION)
+    if (cauldron->color == COLOR_NONE && card->type == CARD_TYPE_POTION)
     {
-        cauldron->color = card.color;
+        cauldron->color = card->color;
     }
 
+    cauldron_features[FEAT_CAULDRON_TOTAL] = cauldron->total_value;
+    cauldron_features[FEAT_CAULDRON_NUM_CARDS] = cauldron->num_cards;
+    cauldron_features[FEAT_CAULDRON_COLOR] = cauldron->color;
+    cauldron_features[FEAT_CAULDRON_COUNTS + type]++;
+
     float reward = 0.0f;
 
     if (cauldron->total_value > CAULDRON_THRESHOLD)
     {
         uint8_t cards_to_collect = cauldron->num_cards - 1;
 
-        for (uint8_t i = 0; i < cards_to_collect; i++)
+        state->hash ^= zobrist_counts(ZOBRIST_CAULDRON, action->cauldron_index, cauldron->counts);
+        state->hash ^= zobrist_key(ZOBRIST_CAULDRON, action->cauldron_index, type, 1);
+        cauldron->counts[type]--;
+        for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
         {
-            player->collected[player->collected_size++] = cauldron->cards[i];
+            for (uint8_t k = 1; k <= cauldron->counts[i]; k++)
+            {
+                state->hash ^= zobrist_key(ZOBRIST_COLLECTED, player_idx, i, player->collected_counts[i] + k);
+            }
+            player->collected_counts[i] += cauldron->counts[i];
+            features[FEAT_COLLECTED_COUNTS + i] += cauldron->counts[i];
         }
+        player->collected_size += cards_to_collect;
+        features[FEAT_COLLECTED_SIZE] += cards_to_collect;
 
         reward = -(float)cards_to_collect;
 
-        cauldron->cards[0] = card;
+        memset(cauldron->counts, 0, sizeof(cauldron->counts));
+        cauldron->cards[0] = type;
+        cauldron->counts[type] = 1;
         cauldron->num_cards = 1;
-        cauldron->total_value = card.value;
+        cauldron->total_value = card->value;
 
-        if (card.type == CARD_TYPE_POTION)
+        if (card->type == CARD_TYPE_POTION)
         {
-            cauldron->color = card.color;
+            cauldron->color = card->color;
         }
         else
         {
             cauldron->color = COLOR_NONE;
         }
+
+        cauldron_sync_features(state, action->cauldron_index);
     }
 
     if (state->variant == GAME_VARIANT_DRAW && state->deck_pos < state->deck_size)
     {
-        if (player->hand_size < TOTAL_CARDS)
+        if (player->hand_size < HAND_CAPACITY)
         {
-            player->hand[player->hand_size++] = state->deck[state->deck_pos++];
+            game_draw_card(state, player_idx);
         }
     }
 
-    state->current_player = (state->current_player + 1) % state->num_players;
+    game_set_current_player(state, (uint8_t)((state->current_player + 1) % state->num_players));
 
     return reward;
 }
@@ -407,19 +618,12 @@ static void game_advance_turn(GameState *state)
     if (!state)
         return;
 
-    state->current_player = (state->current_player + 1) % state->num_players;
+    game_set_current_player(state, (uint8_t)((state->current_player + 1) % state->num_players));
 }
 
 static bool game_is_round_over(const GameState *state)
 {
-    for (uint8_t i = 0; i < state->num_players; i++)
-    {
-        if (state->players[i].hand_size > 0)
-        {
-            return false;
-        }
-    }
-    return true;
+    return state->cards_in_hands == 0;
 }
 
 static Action game_decode_action(uint16_t action_id)
@@ -437,13 +641,41 @@ static Action game_decode_action(uint16_t action_id)
     return action;
 }
 
-StepResult game_step_action(GameState *state, uint16_t action_id)
+static void game_record_undo(const GameState *state, const Action *action, UndoRecord *undo)
+{
+    undo->current_player = state->current_player;
+    undo->deck_pos = state->deck_pos;
+    undo->round_scored = state->round_scored;
+    undo->game_over = state->game_over;
+    undo->hash = state->hash;
+    undo->played = false;
+    undo->overflowed = false;
+
+    for (uint8_t i = 0; i < state->num_players; i++)
+    {
+        undo->scores[i] = state->players[i].score;
+    }
+
+    if (!action)
+        return;
+
+    const Player *player = &state->players[state->current_player];
+    undo->played = true;
+    undo->card_index = action->card_index;
+    undo->card_type = player->hand[action->card_index];
+    undo->cauldron_index = action->cauldron_index;
+    undo->cauldron = state->cauldrons[action->cauldron_index];
+    undo->overflowed = undo->cauldron.total_value + CARD_TYPES[undo->card_type].value > CAULDRON_THRESHOLD;
+}
+
+static StepResult game_step_action_impl(GameState *state, uint16_t action_id, UndoRecord *undo)
 {
     StepResult result = {0};
     result.winner = -1;
 
-    if (!state)
-        return result;
+    if (undo)
+        game_record_undo(state, NULL, undo);
+
     if (state->game_over)
     {
         result.done = true;
@@ -463,6 +695,8 @@ StepResult game_step_action(GameState *state, uint16_t action_id)
         result.action_legal = game_is_action_legal(state, &action);
         if (result.action_legal)
         {
+            if (undo)
+                game_record_undo(state, &action, undo);
             result.reward = game_step(state, &action);
         }
     }
@@ -475,7 +709,7 @@ StepResult game_step_action(GameState *state, uint16_t action_id)
 
     if (result.round_done && state->round >= game_max_rounds(state))
     {
-        state->game_over = true;
+        game_set_flags(state, state->round_scored, true);
     }
 
     result.done = state->game_over;
@@ -487,89 +721,185 @@ StepResult game_step_action(GameState *state, uint16_t action_id)
     return result;
 }
 
-void game_start_new_round(GameState *state)
+StepResult game_step_action(GameState *state, uint16_t action_id)
 {
-    if (!state)
-        return;
+    GAME_PROFILE_SCOPE(GAME_PROFILE_STEP);
 
-    if (state->round >= game_max_rounds(state))
+    if (!state)
     {
-        state->game_over = true;
-        return;
+        StepResult result = {0};
+        result.winner = -1;
+        return result;
     }
 
-    for (uint8_t i = 0; i < state->num_players; i++)
-    {
-        state->players[i].collected_size = 0;
-        state->players[i].hand_size = 0;
-    }
+    return game_step_action_impl(state, action_id, NULL);
+}
 
-    for (uint8_t i = 0; i < NUM_CAULDRONS; i++)
+StepResult game_step_typed_action(GameState *state, uint16_t typed_action)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_STEP_TYPED);
+
+    if (!state)
     {
-        state->cauldrons[i].num_cards = 0;
-        state->cauldrons[i].total_value = 0;
-        state->cauldrons[i].color = COLOR_NONE;
+        StepResult result = {0};
+        result.winner = -1;
+        return result;
     }
 
-    state->dealer = (state->dealer + 1) % state->num_players;
-    state->round++;
-    state->game_over = false;
-    state->round_scored = false;
+    // a type the player does not hold maps past the positional space, which
+    // the step rejects exactly like an illegal positional id
+    uint16_t action_id = game_typed_to_action(state, typed_action);
+    if (action_id == UINT16_MAX)
+        action_id = action_space_size();
+    return game_step_action_impl(state, action_id, NULL);
+}
 
-    game_prepare_deck(state);
+StepResult game_step_with_undo(GameState *state, uint16_t action_id, GameUndo *undo)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_STEP_WITH_UNDO);
 
-    if (state->variant == GAME_VARIANT_DRAW)
+    if (!state || !undo)
     {
-        game_deal_draw_variant(state);
-    }
-    else
-    {
-        deck_deal(state);
+        StepResult result = {0};
+        result.winner = -1;
+        return result;
     }
 
-    state->current_player = (state->dealer + 1) % state->num_players;
+    UndoRecord record;
+    StepResult result = game_step_action_impl(state, action_id, &record);
+    memcpy(undo, &record, sizeof(record));
+    return result;
 }
 
-static void game_calculate_round_scores(const GameState *state, int32_t *scores)
+void game_undo(GameState *state, const GameUndo *undo)
 {
-    if (!state || !scores)
+    GAME_PROFILE_SCOPE(GAME_PROFILE_UNDO);
+
+    if (!state || !undo)
         return;
 
-    int color_counts[NUM_PLAYERS_MAX][NUM_COLORS + 1] = {0};
-    bool immune[NUM_PLAYERS_MAX][NUM_COLORS + 1] = {false};
+    UndoRecord record;
+    memcpy(&record, undo, sizeof(record));
 
-    for (uint8_t p = 0; p < state->num_players; p++)
+    if (!record.round_scored && state->round_scored)
     {
-        const Player *player = &state->players[p];
-        for (uint8_t i = 0; i < player->collected_size; i++)
+        for (uint8_t i = 0; i < state->num_players; i++)
         {
-            const Card card = player->collected[i];
-            if (card.type == CARD_TYPE_POTION)
-            {
-                color_counts[p][card.color]++;
-            }
+            state->players[i].score = record.scores[i];
+            state->player_features[i][FEAT_SCORE] = (int16_t)record.scores[i];
         }
     }
+    state->round_scored = record.round_scored;
+    state->game_over = record.game_over;
+    state->current_player = record.current_player;
+    state->hash = record.hash;
+
+    if (!record.played)
+        return;
 
-    for (Color c = COLOR_RED; c <= COLOR_PURPLE; c++)
+    uint8_t player_idx = record.current_player;
+    Player *player = &state->players[player_idx];
+    int16_t *features = state->player_features[player_idx];
+
+    if (state->deck_pos != record.deck_pos)
     {
-        int max_count = 0;
-        int max_players = 0;
-        uint8_t best_player = 0;
+        uint8_t drawn = player->hand[--player->hand_size];
+        player->hand_counts[drawn]--;
+        state->cards_in_hands--;
+        features[FEAT_HAND_SIZE]--;
+        features[FEAT_HAND_COUNTS + drawn]--;
+        state->deck_pos = record.deck_pos;
+    }
 
-        for (uint8_t p = 0; p < state->num_players; p++)
+    if (record.overflowed)
+    {
+        for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
         {
-            int count = color_counts[p][c];
-            if (count > max_count)
-            {
-                max_count = count;
-                best_player = p;
-                max_players = 1;
-            }
-            else if (count == max_count && count > 0)
-            {
-                max_players++;
-            }
+            player->collected_counts[i] -= record.cauldron.counts[i];
+            features[FEAT_COLLECTED_COUNTS + i] -= record.cauldron.counts[i];
+        }
+        player->collected_size -= record.cauldron.num_cards;
+        features[FEAT_COLLECTED_SIZE] -= record.cauldron.num_cards;
+    }
+
+    state->cauldrons[record.cauldron_index] = record.cauldron;
+    cauldron_sync_features(state, record.cauldron_index);
+
+    memmove(&player->hand[record.card_index + 1], &player->hand[record.card_index],
+            (size_t)(player->hand_size - record.card_index));
+    player->hand[record.card_index] = record.card_type;
+    player->hand_size++;
+    player->hand_counts[record.card_type]++;
+    state->cards_in_hands++;
+    features[FEAT_HAND_SIZE]++;
+    features[FEAT_HAND_COUNTS + record.card_type]++;
+}
+
+void game_start_new_round(GameState *state)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_NEW_ROUND);
+
+    if (!state)
+        return;
+
+    if (state->round >= game_max_rounds(state))
+    {
+        game_set_flags(state, state->round_scored, true);
+        return;
+    }
+
+    game_clear_table(state);
+
+    state->dealer = (state->dealer + 1) % state->num_players;
+    state->round++;
+    state->game_over = false;
+    state->round_scored = false;
+
+    game_prepare_deck(state);
+
+    state->current_player = (state->dealer + 1) % state->num_players;
+    state->hash = game_compute_hash(state);
+}
+
+static void game_calculate_round_scores(const GameState *state, int32_t *scores)
+{
+    if (!state || !scores)
+        return;
+
+    int color_counts[NUM_PLAYERS_MAX][NUM_COLORS] = {0};
+    bool immune[NUM_PLAYERS_MAX][NUM_COLORS] = {false};
+
+    for (uint8_t p = 0; p < state->num_players; p++)
+    {
+        const uint8_t *counts = state->players[p].collected_counts;
+        for (uint8_t c = 0; c < NUM_COLORS; c++)
+        {
+            for (uint8_t v = 0; v < NUM_POTION_VALUES; v++)
+            {
+                color_counts[p][c] += counts[c * NUM_POTION_VALUES + v];
+            }
+        }
+    }
+
+    for (uint8_t c = 0; c < NUM_COLORS; c++)
+    {
+        int max_count = 0;
+        int max_players = 0;
+        uint8_t best_player = 0;
+
+        for (uint8_t p = 0; p < state->num_players; p++)
+        {
+            int count = color_counts[p][c];
+            if (count > max_count)
+            {
+                max_count = count;
+                best_player = p;
+                max_players = 1;
+            }
+            else if (count == max_count && count > 0)
+            {
+                max_players++;
+            }
         }
 
         if (max_count > 0 && max_players == 1)
@@ -580,19 +910,13 @@ static void game_calculate_round_scores(const GameState *state, int32_t *scores)
 
     for (uint8_t p = 0; p < state->num_players; p++)
     {
-        int32_t score = 0;
-        const Player *player = &state->players[p];
+        int32_t score = -2 * (int32_t)state->players[p].collected_counts[POISON_TYPE_INDEX];
 
-        for (uint8_t i = 0; i < player->collected_size; i++)
+        for (uint8_t c = 0; c < NUM_COLORS; c++)
         {
-            const Card card = player->collected[i];
-            if (card.type == CARD_TYPE_POISON)
-            {
-                score -= 2;
-            }
-            else if (!immune[p][card.color])
+            if (!immune[p][c])
             {
-                score -= 1;
+                score -= color_counts[p][c];
             }
         }
 
@@ -613,9 +937,12 @@ void game_apply_round_scores(GameState *state, int32_t *scores)
     {
         for (uint8_t i = 0; i < state->num_players; i++)
         {
+            state->hash ^= zobrist_key(ZOBRIST_SCORE, i, 0, (uint32_t)state->players[i].score);
             state->players[i].score += target[i];
+            state->player_features[i][FEAT_SCORE] = (int16_t)state->players[i].score;
+            state->hash ^= zobrist_key(ZOBRIST_SCORE, i, 0, (uint32_t)state->players[i].score);
         }
-        state->round_scored = true;
+        game_set_flags(state, true, state->game_over);
     }
 }
 
@@ -672,6 +999,11 @@ uint8_t game_get_round(const GameState *state)
     return state ? state->round : 0;
 }
 
+uint64_t game_get_hash(const GameState *state)
+{
+    return state ? state->hash : 0;
+}
+
 uint8_t game_get_player_hand_size(const GameState *state, uint8_t player)
 {
     if (!state || player >= state->num_players)
@@ -700,7 +1032,7 @@ bool game_get_player_hand_card(const GameState *state, uint8_t player, uint8_t c
     const Player *p = &state->players[player];
     if (card_index >= p->hand_size)
         return false;
-    *out = p->hand[card_index];
+    *out = CARD_TYPES[p->hand[card_index]];
     return true;
 }
 
@@ -711,8 +1043,19 @@ bool game_get_player_collected_card(const GameState *state, uint8_t player, uint
     const Player *p = &state->players[player];
     if (card_index >= p->collected_size)
         return false;
-    *out = p->collected[card_index];
-    return true;
+
+    // collected piles are unordered; cards are reported grouped by type
+    uint8_t remaining = card_index;
+    for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
+    {
+        if (remaining < p->collected_counts[i])
+        {
+            *out = CARD_TYPES[i];
+            return true;
+        }
+        remaining -= p->collected_counts[i];
+    }
+    return false;
 }
 
 uint8_t game_get_cauldron_num_cards(const GameState *state, uint8_t cauldron)
@@ -743,7 +1086,7 @@ bool game_get_cauldron_card(const GameState *state, uint8_t cauldron, uint8_t ca
     const Cauldron *c = &state->cauldrons[cauldron];
     if (card_index >= c->num_cards)
         return false;
-    *out = c->cards[card_index];
+    *out = CARD_TYPES[c->cards[card_index]];
     return true;
 }
 
@@ -752,120 +1095,1511 @@ size_t game_observation_size(void)
     return observation_size();
 }
 
-size_t game_get_observation(const GameState *state, uint8_t perspective_player, GameObsMode mode, float *out, size_t out_len)
+static void features_to_float(const int16_t *features, size_t count, float *out)
 {
-    if (!state || !out)
-        return 0;
-    const size_t obs_size = observation_size();
-    if (out_len < obs_size)
-        return 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = (float)features[i];
+    }
+}
 
+// observation as int16 in the float layout; every encoding is produced from this
+static size_t game_write_observation_i16(const GameState *state, uint8_t perspective_player, GameObsMode mode,
+                                         int16_t *out)
+{
     size_t idx = 0;
-    const size_t player_stride = 3 + 2 * NUM_CARD_TYPES;
     uint8_t base = (perspective_player < state->num_players) ? perspective_player : 0;
     uint8_t rel_current = (uint8_t)((state->current_player + state->num_players - base) % state->num_players);
     uint8_t rel_dealer = (uint8_t)((state->dealer + state->num_players - base) % state->num_players);
+    bool hide_collected = mode == GAME_OBS_PARTIAL && !state->round_scored;
 
-    out[idx++] = (float)state->num_players;
-    out[idx++] = (float)rel_current;
-    out[idx++] = (float)rel_dealer;
-    out[idx++] = (float)state->round;
-    out[idx++] = (float)state->variant;
-    out[idx++] = (float)(state->deck_size - state->deck_pos);
+    out[idx++] = state->num_players;
+    out[idx++] = rel_current;
+    out[idx++] = rel_dealer;
+    out[idx++] = state->round;
+    out[idx++] = (int16_t)state->variant;
+    out[idx++] = (int16_t)(state->deck_size - state->deck_pos);
 
+    // seats are rotated so the perspective player comes first
     for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++)
     {
-        if (slot < state->num_players)
+        int16_t *row = out + idx;
+        idx += OBS_PLAYER_FEATURES;
+
+        if (slot >= state->num_players)
         {
-            uint8_t player_idx = (uint8_t)((base + slot) % state->num_players);
-            const Player *player = &state->players[player_idx];
-            uint8_t counts[NUM_CARD_TYPES];
+            memset(row, 0, OBS_PLAYER_FEATURES * sizeof(int16_t));
+            continue;
+        }
 
-            out[idx++] = (float)player->hand_size;
-            out[idx++] = (float)player->collected_size;
-            out[idx++] = (float)player->score;
+        uint8_t player_idx = (uint8_t)((base + slot) % state->num_players);
+        memcpy(row, state->player_features[player_idx], OBS_PLAYER_FEATURES * sizeof(int16_t));
 
-            if (mode == GAME_OBS_PARTIAL && player_idx != base)
-            {
-                for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
-                {
-                    out[idx++] = 0.0f;
-                }
-            }
-            else
-            {
-                game_count_cards(player->hand, player->hand_size, counts);
-                for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
-                {
-                    out[idx++] = (float)counts[i];
-                }
-            }
+        if (mode == GAME_OBS_PARTIAL && player_idx != base)
+            memset(row + FEAT_HAND_COUNTS, 0, NUM_CARD_TYPES * sizeof(int16_t));
+        if (hide_collected)
+            memset(row + FEAT_COLLECTED_COUNTS, 0, NUM_CARD_TYPES * sizeof(int16_t));
+    }
 
-            if (mode == GAME_OBS_PARTIAL && !state->round_scored)
-            {
-                for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
-                {
-                    out[idx++] = 0.0f;
-                }
-            }
-            else
-            {
-                game_count_cards(player->collected, player->collected_size, counts);
-                for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
-                {
-                    out[idx++] = (float)counts[i];
-                }
-            }
-        }
-        else
+    memcpy(out + idx, state->cauldron_features, sizeof(state->cauldron_features));
+    idx += NUM_CAULDRONS * OBS_CAULDRON_FEATURES;
+
+    return idx;
+}
+
+static size_t game_write_observation(const GameState *state, uint8_t perspective_player, GameObsMode mode, float *out)
+{
+    int16_t features[OBS_SIZE];
+    size_t count = game_write_observation_i16(state, perspective_player, mode, features);
+    features_to_float(features, count, out);
+    return count;
+}
+
+size_t game_get_observation(const GameState *state, uint8_t perspective_player, GameObsMode mode, float *out, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_OBSERVATION);
+
+    if (!state || !out)
+        return 0;
+    if (out_len < observation_size())
+        return 0;
+
+    return game_write_observation(state, perspective_player, mode, out);
+}
+
+size_t game_get_observations_all(const GameState *state, GameObsMode mode, float *out, size_t stride, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_OBSERVATIONS_ALL);
+
+    if (!state || !out || stride < OBS_SIZE)
+        return 0;
+    uint8_t num_players = state->num_players;
+    if (out_len < (num_players - 1) * stride + OBS_SIZE)
+        return 0;
+
+    // rows and cauldrons are widened once and copied into every seat's view
+    float rows[NUM_PLAYERS_MAX][OBS_PLAYER_FEATURES];
+    float cauldrons[NUM_CAULDRONS * OBS_CAULDRON_FEATURES];
+    features_to_float(&state->player_features[0][0], (size_t)num_players * OBS_PLAYER_FEATURES, &rows[0][0]);
+    features_to_float(&state->cauldron_features[0][0], NUM_CAULDRONS * OBS_CAULDRON_FEATURES, cauldrons);
+
+    if (mode == GAME_OBS_PARTIAL && !state->round_scored)
+    {
+        for (uint8_t p = 0; p < num_players; p++)
+            memset(rows[p] + FEAT_COLLECTED_COUNTS, 0, NUM_CARD_TYPES * sizeof(float));
+    }
+
+    for (uint8_t base = 0; base < num_players; base++)
+    {
+        float *obs = out + base * stride;
+        size_t idx = 0;
+
+        obs[idx++] = (float)num_players;
+        obs[idx++] = (float)((state->current_player + num_players - base) % num_players);
+        obs[idx++] = (float)((state->dealer + num_players - base) % num_players);
+        obs[idx++] = (float)state->round;
+        obs[idx++] = (float)state->variant;
+        obs[idx++] = (float)(state->deck_size - state->deck_pos);
+
+        for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++)
         {
-            for (uint8_t i = 0; i < player_stride; i++)
+            float *row = obs + idx;
+            idx += OBS_PLAYER_FEATURES;
+
+            if (slot >= num_players)
             {
-                out[idx++] = 0.0f;
+                memset(row, 0, OBS_PLAYER_FEATURES * sizeof(float));
+                continue;
             }
+
+            uint8_t player_idx = (uint8_t)(base + slot);
+            if (player_idx >= num_players)
+                player_idx = (uint8_t)(player_idx - num_players);
+            memcpy(row, rows[player_idx], OBS_PLAYER_FEATURES * sizeof(float));
+
+            if (mode == GAME_OBS_PARTIAL && player_idx != base)
+                memset(row + FEAT_HAND_COUNTS, 0, NUM_CARD_TYPES * sizeof(float));
         }
+
+        memcpy(obs + idx, cauldrons, sizeof(cauldrons));
     }
 
-    for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+    return (size_t)num_players * OBS_SIZE;
+}
+
+// field widths of GAME_OBS_FORMAT_BITS, in float layout order
+#define OBS_BITS_HAND_SIZE 5
+#define OBS_BITS_COLLECTED_SIZE 6
+#define OBS_BITS_SCORE 9
+#define OBS_BITS_COUNT 4
+#define OBS_BITS_CAULDRON_TOTAL 5
+#define OBS_BITS_CAULDRON_NUM_CARDS 5
+#define OBS_BITS_CAULDRON_COLOR 2
+#define OBS_BITS_HEADER 19
+#define OBS_BITS_PLAYER (OBS_BITS_HAND_SIZE + OBS_BITS_COLLECTED_SIZE + OBS_BITS_SCORE + 2 * NUM_CARD_TYPES * OBS_BITS_COUNT)
+#define OBS_BITS_CAULDRON \
+    (OBS_BITS_CAULDRON_TOTAL + OBS_BITS_CAULDRON_NUM_CARDS + OBS_BITS_CAULDRON_COLOR + NUM_CARD_TYPES * OBS_BITS_COUNT)
+#define OBS_BITS_TOTAL (OBS_BITS_HEADER + NUM_PLAYERS_MAX * OBS_BITS_PLAYER + NUM_CAULDRONS * OBS_BITS_CAULDRON)
+#define OBS_PACKED_BYTES (((OBS_BITS_TOTAL + 63) / 64) * 8)
+
+_Static_assert(NUM_CARD_TYPES * OBS_BITS_COUNT == 64, "a histogram row should pack into one word");
+
+static const uint8_t OBS_HEADER_BITS[OBS_HEADER_FEATURES] = {3, 3, 3, 3, 1, 6};
+
+// scores are the only negative features; the unsigned formats store them negated
+static void obs_negate_scores(int16_t *features)
+{
+    for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++)
     {
-        const Cauldron *cauldron = &state->cauldrons[c];
-        uint8_t counts[NUM_CARD_TYPES];
+        int16_t *score = &features[OBS_HEADER_FEATURES + slot * OBS_PLAYER_FEATURES + FEAT_SCORE];
+        *score = (int16_t)-*score;
+    }
+}
 
-        out[idx++] = (float)cauldron->total_value;
-        out[idx++] = (float)cauldron->num_cards;
-        out[idx++] = (float)cauldron->color;
+static void obs_negate_scores_float(float *out)
+{
+    for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++)
+    {
+        float *score = &out[OBS_HEADER_FEATURES + slot * OBS_PLAYER_FEATURES + FEAT_SCORE];
+        *score = *score == 0.0f ? 0.0f : -*score;
+    }
+}
 
-        game_count_cards(cauldron->cards, cauldron->num_cards, counts);
-        for (uint8_t i = 0; i < NUM_CARD_TYPES; i++)
-        {
-            out[idx++] = (float)counts[i];
-        }
+static int16_t clamp_i16(int32_t value, int32_t lo, int32_t hi)
+{
+    return (int16_t)(value < lo ? lo : value > hi ? hi : value);
+}
+
+typedef struct
+{
+    uint8_t *out;
+    size_t pos;
+    uint64_t word;
+    unsigned used;
+} ObsBitWriter;
+
+typedef struct
+{
+    const uint8_t *in;
+    size_t pos;
+    uint64_t word;
+    unsigned avail;
+} ObsBitReader;
+
+static void obs_bits_put(ObsBitWriter *writer, uint64_t value, unsigned bits)
+{
+    writer->word |= value << writer->used;
+    writer->used += bits;
+    if (writer->used >= 64)
+    {
+        memcpy(writer->out + writer->pos, &writer->word, sizeof(writer->word));
+        writer->pos += sizeof(writer->word);
+        writer->used -= 64;
+        writer->word = writer->used ? value >> (bits - writer->used) : 0;
     }
+}
 
-    return idx;
+static void obs_bits_put_field(ObsBitWriter *writer, int16_t value, unsigned bits)
+{
+    obs_bits_put(writer, (uint64_t)clamp_i16(value, 0, (1 << bits) - 1), bits);
 }
 
-uint16_t game_action_space_size(void)
+// a histogram row of NUM_CARD_TYPES counts as one word of OBS_BITS_COUNT-bit fields
+static void obs_bits_put_counts(ObsBitWriter *writer, const int16_t *counts)
 {
-    return action_space_size();
+    uint64_t packed = 0;
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+        packed |= (uint64_t)clamp_i16(counts[t], 0, (1 << OBS_BITS_COUNT) - 1) << (t * OBS_BITS_COUNT);
+    obs_bits_put(writer, packed, 64);
 }
 
-size_t game_get_legal_action_mask(const GameState *state, uint8_t *out_mask, size_t out_len)
+static uint64_t obs_bits_get(ObsBitReader *reader, unsigned bits)
 {
-    if (!state || !out_mask)
+    uint64_t mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+    uint64_t value = reader->word;
+    unsigned taken = reader->avail;
+
+    if (taken >= bits)
+    {
+        reader->word = bits == 64 ? 0 : reader->word >> bits;
+        reader->avail -= bits;
+        return value & mask;
+    }
+
+    uint64_t next = 0;
+    if (reader->pos < OBS_PACKED_BYTES)
+        memcpy(&next, reader->in + reader->pos, sizeof(next));
+    reader->pos += sizeof(next);
+
+    unsigned needed = bits - taken;
+    value |= next << taken;
+    reader->word = needed == 64 ? 0 : next >> needed;
+    reader->avail = 64 - needed;
+    return value & mask;
+}
+
+static void obs_bits_get_counts(ObsBitReader *reader, float *out)
+{
+    uint64_t packed = obs_bits_get(reader, 64);
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+        out[t] = (float)((packed >> (t * OBS_BITS_COUNT)) & ((1u << OBS_BITS_COUNT) - 1));
+}
+
+// features must already have their scores negated
+static void game_pack_observation_bits(const int16_t *features, uint8_t *out)
+{
+    ObsBitWriter writer = {out, 0, 0, 0};
+
+    for (uint8_t i = 0; i < OBS_HEADER_FEATURES; i++)
+        obs_bits_put_field(&writer, features[i], OBS_HEADER_BITS[i]);
+
+    const int16_t *row = features + OBS_HEADER_FEATURES;
+    for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++, row += OBS_PLAYER_FEATURES)
+    {
+        obs_bits_put_field(&writer, row[FEAT_HAND_SIZE], OBS_BITS_HAND_SIZE);
+        obs_bits_put_field(&writer, row[FEAT_COLLECTED_SIZE], OBS_BITS_COLLECTED_SIZE);
+        obs_bits_put_field(&writer, row[FEAT_SCORE], OBS_BITS_SCORE);
+        obs_bits_put_counts(&writer, row + FEAT_HAND_COUNTS);
+        obs_bits_put_counts(&writer, row + FEAT_COLLECTED_COUNTS);
+    }
+
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++, row += OBS_CAULDRON_FEATURES)
+    {
+        obs_bits_put_field(&writer, row[FEAT_CAULDRON_TOTAL], OBS_BITS_CAULDRON_TOTAL);
+        obs_bits_put_field(&writer, row[FEAT_CAULDRON_NUM_CARDS], OBS_BITS_CAULDRON_NUM_CARDS);
+        obs_bits_put_field(&writer, row[FEAT_CAULDRON_COLOR], OBS_BITS_CAULDRON_COLOR);
+        obs_bits_put_counts(&writer, row + FEAT_CAULDRON_COUNTS);
+    }
+
+    if (writer.used)
+    {
+        memcpy(out + writer.pos, &writer.word, sizeof(writer.word));
+        writer.pos += sizeof(writer.word);
+    }
+    memset(out + writer.pos, 0, OBS_PACKED_BYTES - writer.pos);
+}
+
+static void game_unpack_observation_bits(const uint8_t *packed, float *out)
+{
+    ObsBitReader reader = {packed, 0, 0, 0};
+
+    for (uint8_t i = 0; i < OBS_HEADER_FEATURES; i++)
+        out[i] = (float)obs_bits_get(&reader, OBS_HEADER_BITS[i]);
+
+    float *row = out + OBS_HEADER_FEATURES;
+    for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++, row += OBS_PLAYER_FEATURES)
+    {
+        row[FEAT_HAND_SIZE] = (float)obs_bits_get(&reader, OBS_BITS_HAND_SIZE);
+        row[FEAT_COLLECTED_SIZE] = (float)obs_bits_get(&reader, OBS_BITS_COLLECTED_SIZE);
+        row[FEAT_SCORE] = (float)obs_bits_get(&reader, OBS_BITS_SCORE);
+        obs_bits_get_counts(&reader, row + FEAT_HAND_COUNTS);
+        obs_bits_get_counts(&reader, row + FEAT_COLLECTED_COUNTS);
+    }
+
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++, row += OBS_CAULDRON_FEATURES)
+    {
+        row[FEAT_CAULDRON_TOTAL] = (float)obs_bits_get(&reader, OBS_BITS_CAULDRON_TOTAL);
+        row[FEAT_CAULDRON_NUM_CARDS] = (float)obs_bits_get(&reader, OBS_BITS_CAULDRON_NUM_CARDS);
+        row[FEAT_CAULDRON_COLOR] = (float)obs_bits_get(&reader, OBS_BITS_CAULDRON_COLOR);
+        obs_bits_get_counts(&reader, row + FEAT_CAULDRON_COUNTS);
+    }
+
+    obs_negate_scores_float(out);
+}
+
+// features is scratch: the unsigned formats negate its scores in place
+static void game_encode_observation(int16_t *features, GameObsFormat format, void *out)
+{
+    switch (format)
+    {
+    case GAME_OBS_FORMAT_F32:
+        features_to_float(features, OBS_SIZE, out);
+        break;
+    case GAME_OBS_FORMAT_U8:
+    {
+        uint8_t *bytes = out;
+        obs_negate_scores(features);
+        for (size_t i = 0; i < OBS_SIZE; i++)
+            bytes[i] = (uint8_t)clamp_i16(features[i], 0, UINT8_MAX);
+        break;
+    }
+    case GAME_OBS_FORMAT_I8:
+    {
+        int8_t *bytes = out;
+        for (size_t i = 0; i < OBS_SIZE; i++)
+            bytes[i] = (int8_t)clamp_i16(features[i], INT8_MIN, INT8_MAX);
+        break;
+    }
+    case GAME_OBS_FORMAT_BITS:
+        obs_negate_scores(features);
+        game_pack_observation_bits(features, out);
+        break;
+    }
+}
+
+size_t game_observation_bytes(GameObsFormat format)
+{
+    switch (format)
+    {
+    case GAME_OBS_FORMAT_F32:
+        return OBS_SIZE * sizeof(float);
+    case GAME_OBS_FORMAT_U8:
+    case GAME_OBS_FORMAT_I8:
+        return OBS_SIZE;
+    case GAME_OBS_FORMAT_BITS:
+        return OBS_PACKED_BYTES;
+    }
+    return 0;
+}
+
+size_t game_get_observation_encoded(const GameState *state, uint8_t perspective_player, GameObsMode mode,
+                                    GameObsFormat format, void *out, size_t out_bytes)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_OBSERVATION_ENCODED);
+
+    size_t bytes = game_observation_bytes(format);
+    if (!state || !out || bytes == 0 || out_bytes < bytes)
         return 0;
-    const uint16_t action_space = action_space_size();
-    if (out_len < action_space)
+
+    int16_t features[OBS_SIZE];
+    game_write_observation_i16(state, perspective_player, mode, features);
+    game_encode_observation(features, format, out);
+    return bytes;
+}
+
+size_t game_decode_observation(const void *encoded, GameObsFormat format, float *out, size_t out_len)
+{
+    if (!encoded || !out || out_len < OBS_SIZE || game_observation_bytes(format) == 0)
         return 0;
 
-    size_t count = 0;
-    for (uint16_t action_id = 0; action_id < action_space; action_id++)
+    switch (format)
     {
-        Action action = game_decode_action(action_id);
-        bool legal = game_is_action_legal(state, &action);
-        out_mask[action_id] = legal ? 1 : 0;
-        if (legal)
-            count++;
+    case GAME_OBS_FORMAT_F32:
+        memcpy(out, encoded, OBS_SIZE * sizeof(float));
+        break;
+    case GAME_OBS_FORMAT_U8:
+    {
+        const uint8_t *bytes = encoded;
+        for (size_t i = 0; i < OBS_SIZE; i++)
+            out[i] = (float)bytes[i];
+        obs_negate_scores_float(out);
+        break;
     }
-    return count;
+    case GAME_OBS_FORMAT_I8:
+    {
+        const int8_t *bytes = encoded;
+        for (size_t i = 0; i < OBS_SIZE; i++)
+            out[i] = (float)bytes[i];
+        break;
+    }
+    case GAME_OBS_FORMAT_BITS:
+        game_unpack_observation_bits(encoded, out);
+        break;
+    }
+    return OBS_SIZE;
+}
+
+uint16_t game_action_space_size(void)
+{
+    return action_space_size();
+}
+
+// per card type, the cauldrons it may legally be played on (bit c = cauldron c)
+static void game_type_cauldron_masks(const GameState *state, uint8_t *out_masks)
+{
+    uint8_t claimed = 0;
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+    {
+        claimed |= (uint8_t)(1u << state->cauldrons[c].color);
+    }
+
+    uint8_t empty_cauldrons = 0;
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+    {
+        if (state->cauldrons[c].color == COLOR_NONE)
+            empty_cauldrons |= (uint8_t)(1u << c);
+    }
+
+    for (Color color = COLOR_RED; color <= COLOR_PURPLE; color++)
+    {
+        uint8_t allowed = 0;
+        if (claimed & (1u << color))
+        {
+            for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+            {
+                if (state->cauldrons[c].color == color)
+                    allowed |= (uint8_t)(1u << c);
+            }
+        }
+        else
+        {
+            allowed = empty_cauldrons;
+        }
+
+        uint8_t first = (uint8_t)(game_color_index(color) * NUM_POTION_VALUES);
+        memset(&out_masks[first], allowed, NUM_POTION_VALUES);
+    }
+
+    out_masks[POISON_TYPE_INDEX] = (uint8_t)((1u << NUM_CAULDRONS) - 1);
+}
+
+// hands never exceed HAND_CAPACITY cards, so every legal action id fits in the first word
+_Static_assert(HAND_CAPACITY * NUM_CAULDRONS <= 64, "legal actions must fit in one word");
+
+static uint64_t game_legal_action_word(const GameState *state)
+{
+    const Player *player = &state->players[state->current_player];
+    uint8_t type_masks[NUM_CARD_TYPES];
+    uint64_t bits = 0;
+
+    game_type_cauldron_masks(state, type_masks);
+    for (uint8_t i = 0; i < player->hand_size; i++)
+    {
+        bits |= (uint64_t)type_masks[player->hand[i]] << (i * NUM_CAULDRONS);
+    }
+    return bits;
+}
+
+static size_t game_write_legal_action_mask(const GameState *state, uint8_t *out_mask)
+{
+    uint64_t bits = game_legal_action_word(state);
+
+    memset(out_mask, 0, action_space_size());
+    for (uint64_t rest = bits; rest; rest &= rest - 1)
+    {
+        out_mask[__builtin_ctzll(rest)] = 1;
+    }
+    return (size_t)__builtin_popcountll(bits);
+}
+
+size_t game_get_legal_action_mask(const GameState *state, uint8_t *out_mask, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_LEGAL_MASK);
+
+    if (!state || !out_mask)
+        return 0;
+    if (out_len < action_space_size())
+        return 0;
+
+    return game_write_legal_action_mask(state, out_mask);
+}
+
+size_t game_legal_action_words(void)
+{
+    return LEGAL_ACTION_WORDS;
+}
+
+size_t game_get_legal_action_bits(const GameState *state, uint64_t *out_words, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_LEGAL_BITS);
+
+    if (!state || !out_words)
+        return 0;
+    if (out_len < LEGAL_ACTION_WORDS)
+        return 0;
+
+    uint64_t bits = game_legal_action_word(state);
+    out_words[0] = bits;
+    memset(&out_words[1], 0, (LEGAL_ACTION_WORDS - 1) * sizeof(uint64_t));
+    return (size_t)__builtin_popcountll(bits);
+}
+
+uint16_t game_sample_legal_action(const GameState *state, GameRng *rng)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_SAMPLE_ACTION);
+
+    if (!state || !rng)
+        return 0;
+
+    uint64_t bits = game_legal_action_word(state);
+    if (!bits)
+        return 0;
+
+    uint32_t pick = rng_bounded(rng, (uint32_t)__builtin_popcountll(bits));
+    while (pick--)
+    {
+        bits &= bits - 1;
+    }
+    return (uint16_t)__builtin_ctzll(bits);
+}
+
+uint16_t game_typed_action_space_size(void)
+{
+    return TYPED_ACTIONS;
+}
+
+uint8_t game_card_type_id(const Card *card)
+{
+    if (!card)
+        return UINT8_MAX;
+    if (card->type == CARD_TYPE_POISON)
+        return POISON_TYPE_INDEX;
+
+    for (uint8_t t = 0; t < POISON_TYPE_INDEX; t++)
+    {
+        if (CARD_TYPES[t].color == card->color && CARD_TYPES[t].value == card->value)
+            return t;
+    }
+    return UINT8_MAX;
+}
+
+bool game_card_from_type_id(uint8_t type_id, Card *out)
+{
+    if (!out || type_id >= NUM_CARD_TYPES)
+        return false;
+
+    *out = CARD_TYPES[type_id];
+    return true;
+}
+
+// bit type * NUM_CAULDRONS + c: the current player holds that type and may play it on c
+static uint64_t game_typed_legal_word(const GameState *state)
+{
+    const Player *player = &state->players[state->current_player];
+    uint8_t type_masks[NUM_CARD_TYPES];
+    uint64_t bits = 0;
+
+    game_type_cauldron_masks(state, type_masks);
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+    {
+        if (player->hand_counts[t])
+            bits |= (uint64_t)type_masks[t] << (t * NUM_CAULDRONS);
+    }
+    return bits;
+}
+
+static size_t game_write_typed_legal_mask(const GameState *state, uint8_t *out_mask)
+{
+    uint64_t bits = game_typed_legal_word(state);
+
+    memset(out_mask, 0, TYPED_ACTIONS);
+    for (uint64_t rest = bits; rest; rest &= rest - 1)
+    {
+        out_mask[__builtin_ctzll(rest)] = 1;
+    }
+    return (size_t)__builtin_popcountll(bits);
+}
+
+size_t game_get_typed_legal_action_mask(const GameState *state, uint8_t *out_mask, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_LEGAL_TYPED_MASK);
+
+    if (!state || !out_mask)
+        return 0;
+    if (out_len < TYPED_ACTIONS)
+        return 0;
+
+    return game_write_typed_legal_mask(state, out_mask);
+}
+
+size_t game_get_typed_legal_action_bits(const GameState *state, uint64_t *out_bits)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_LEGAL_TYPED_BITS);
+
+    if (!state || !out_bits)
+        return 0;
+
+    *out_bits = game_typed_legal_word(state);
+    return (size_t)__builtin_popcountll(*out_bits);
+}
+
+uint16_t game_action_to_typed(const GameState *state, uint16_t action_id)
+{
+    if (!state || action_id >= action_space_size())
+        return UINT16_MAX;
+
+    const Player *player = &state->players[state->current_player];
+    uint8_t card_index = (uint8_t)(action_id / NUM_CAULDRONS);
+    if (card_index >= player->hand_size)
+        return UINT16_MAX;
+
+    return (uint16_t)(player->hand[card_index] * NUM_CAULDRONS + action_id % NUM_CAULDRONS);
+}
+
+uint16_t game_typed_to_action(const GameState *state, uint16_t typed_action)
+{
+    if (!state || typed_action >= TYPED_ACTIONS)
+        return UINT16_MAX;
+
+    const Player *player = &state->players[state->current_player];
+    uint8_t type = (uint8_t)(typed_action / NUM_CAULDRONS);
+    if (!player->hand_counts[type])
+        return UINT16_MAX;
+
+    uint8_t card_index = 0;
+    while (player->hand[card_index] != type)
+        card_index++;
+    return (uint16_t)(card_index * NUM_CAULDRONS + typed_action % NUM_CAULDRONS);
+}
+
+// colour symmetry. COLOR_PERMS[p][c] is the colour index that colour index c
+// becomes under permutation p; entry 0 is the identity
+static const uint8_t COLOR_PERMS[GAME_NUM_COLOR_PERMS][NUM_COLORS] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0},
+};
+static const uint8_t COLOR_PERM_INVERSE[GAME_NUM_COLOR_PERMS] = {0, 1, 2, 4, 3, 5};
+
+// canonical keys are compared per colour: hash-level content first (counts,
+// cauldron colours, deck order), then hand and cauldron order as a tie-break
+#define COLOR_KEY_PLAYER (2 * NUM_POTION_VALUES)
+#define COLOR_KEY_CAULDRON (1 + NUM_POTION_VALUES)
+#define COLOR_KEY_SIZE                                                                                                 \
+    (NUM_PLAYERS_MAX * (COLOR_KEY_PLAYER + HAND_CAPACITY) + NUM_CAULDRONS * (COLOR_KEY_CAULDRON + CAULDRON_CAPACITY) + \
+     TOTAL_CARDS)
+#define OBS_COLOR_KEY_SIZE (NUM_PLAYERS_MAX * COLOR_KEY_PLAYER + NUM_CAULDRONS * COLOR_KEY_CAULDRON)
+
+static void color_perm_types(uint8_t perm, uint8_t *out_types)
+{
+    for (uint8_t t = 0; t < POISON_TYPE_INDEX; t++)
+    {
+        uint8_t color = COLOR_PERMS[perm][t / NUM_POTION_VALUES];
+        out_types[t] = (uint8_t)(color * NUM_POTION_VALUES + t % NUM_POTION_VALUES);
+    }
+    out_types[POISON_TYPE_INDEX] = POISON_TYPE_INDEX;
+}
+
+static uint8_t color_perm_enum(uint8_t perm, uint8_t color)
+{
+    return color == COLOR_NONE ? COLOR_NONE : (uint8_t)(COLOR_PERMS[perm][color - COLOR_RED] + COLOR_RED);
+}
+
+static void permute_counts_u8(const uint8_t *types, const uint8_t *in, uint8_t *out)
+{
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+    {
+        out[types[t]] = in[t];
+    }
+}
+
+static void permute_counts_i16(const uint8_t *types, const int16_t *in, int16_t *out)
+{
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+    {
+        out[types[t]] = in[t];
+    }
+}
+
+static void permute_counts_f32(const uint8_t *types, const float *in, float *out)
+{
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+    {
+        out[types[t]] = in[t];
+    }
+}
+
+// permutation whose image of colour c is rank[c]
+static uint8_t color_perm_from_ranks(const uint8_t *rank)
+{
+    for (uint8_t p = 0; p < GAME_NUM_COLOR_PERMS; p++)
+    {
+        if (memcmp(COLOR_PERMS[p], rank, NUM_COLORS) == 0)
+            return p;
+    }
+    return 0;
+}
+
+// ranks colours by descending key; equal keys keep index order
+static uint8_t color_perm_from_keys(const void *keys, size_t key_size, int (*compare)(const void *, const void *, size_t))
+{
+    uint8_t order[NUM_COLORS] = {0, 1, 2};
+    const uint8_t *base = keys;
+
+    for (uint8_t i = 1; i < NUM_COLORS; i++)
+    {
+        uint8_t c = order[i];
+        uint8_t j = i;
+        while (j > 0 && compare(base + c * key_size, base + order[j - 1] * key_size, key_size) > 0)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = c;
+    }
+
+    uint8_t rank[NUM_COLORS];
+    for (uint8_t i = 0; i < NUM_COLORS; i++)
+    {
+        rank[order[i]] = i;
+    }
+    return color_perm_from_ranks(rank);
+}
+
+static int compare_obs_keys(const void *a, const void *b, size_t size)
+{
+    const float *x = a;
+    const float *y = b;
+    for (size_t i = 0; i < size / sizeof(float); i++)
+    {
+        if (x[i] != y[i])
+            return x[i] > y[i] ? 1 : -1;
+    }
+    return 0;
+}
+
+Color game_color_perm_apply(uint8_t perm, Color color)
+{
+    if (perm >= GAME_NUM_COLOR_PERMS || color < COLOR_RED || color > COLOR_PURPLE)
+        return COLOR_NONE;
+    return (Color)color_perm_enum(perm, (uint8_t)color);
+}
+
+uint8_t game_color_perm_inverse(uint8_t perm)
+{
+    return perm < GAME_NUM_COLOR_PERMS ? COLOR_PERM_INVERSE[perm] : 0;
+}
+
+uint8_t game_color_perm_compose(uint8_t first, uint8_t second)
+{
+    if (first >= GAME_NUM_COLOR_PERMS || second >= GAME_NUM_COLOR_PERMS)
+        return 0;
+
+    uint8_t rank[NUM_COLORS];
+    for (uint8_t c = 0; c < NUM_COLORS; c++)
+    {
+        rank[c] = COLOR_PERMS[second][COLOR_PERMS[first][c]];
+    }
+    return color_perm_from_ranks(rank);
+}
+
+bool game_permute_colors(const GameState *state, uint8_t perm, GameState *out)
+{
+    if (!state || !out || perm >= GAME_NUM_COLOR_PERMS)
+        return false;
+
+    uint8_t types[NUM_CARD_TYPES];
+    color_perm_types(perm, types);
+
+    // out may alias state, so read from a copy
+    GameState src;
+    memcpy(&src, state, sizeof(src));
+    if (out != state)
+        memcpy(out, state, sizeof(*out));
+
+    for (uint8_t p = 0; p < src.num_players; p++)
+    {
+        const Player *from = &src.players[p];
+        Player *to = &out->players[p];
+        for (uint8_t i = 0; i < from->hand_size; i++)
+        {
+            to->hand[i] = types[from->hand[i]];
+        }
+        permute_counts_u8(types, from->hand_counts, to->hand_counts);
+        permute_counts_u8(types, from->collected_counts, to->collected_counts);
+        permute_counts_i16(types, &src.player_features[p][FEAT_HAND_COUNTS], &out->player_features[p][FEAT_HAND_COUNTS]);
+        permute_counts_i16(types, &src.player_features[p][FEAT_COLLECTED_COUNTS],
+                           &out->player_features[p][FEAT_COLLECTED_COUNTS]);
+    }
+
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+    {
+        const Cauldron *from = &src.cauldrons[c];
+        Cauldron *to = &out->cauldrons[c];
+        for (uint8_t i = 0; i < from->num_cards; i++)
+        {
+            to->cards[i] = types[from->cards[i]];
+        }
+        permute_counts_u8(types, from->counts, to->counts);
+        to->color = color_perm_enum(perm, from->color);
+        out->cauldron_features[c][FEAT_CAULDRON_COLOR] = to->color;
+        permute_counts_i16(types, &src.cauldron_features[c][FEAT_CAULDRON_COUNTS],
+                           &out->cauldron_features[c][FEAT_CAULDRON_COUNTS]);
+    }
+
+    for (uint8_t i = 0; i < src.deck_size; i++)
+    {
+        out->deck[i] = types[src.deck[i]];
+    }
+
+    out->hash = game_compute_hash(out);
+    return true;
+}
+
+uint8_t game_canonical_color_perm(const GameState *state)
+{
+    if (!state)
+        return 0;
+
+    uint8_t keys[NUM_COLORS][COLOR_KEY_SIZE] = {{0}};
+    size_t idx = 0;
+
+    for (uint8_t p = 0; p < state->num_players; p++)
+    {
+        const Player *player = &state->players[p];
+        for (uint8_t c = 0; c < NUM_COLORS; c++)
+        {
+            uint8_t *key = &keys[c][p * COLOR_KEY_PLAYER];
+            memcpy(key, &player->hand_counts[c * NUM_POTION_VALUES], NUM_POTION_VALUES);
+            memcpy(key + NUM_POTION_VALUES, &player->collected_counts[c * NUM_POTION_VALUES], NUM_POTION_VALUES);
+        }
+    }
+    idx += NUM_PLAYERS_MAX * COLOR_KEY_PLAYER;
+
+    for (uint8_t k = 0; k < NUM_CAULDRONS; k++)
+    {
+        const Cauldron *cauldron = &state->cauldrons[k];
+        for (uint8_t c = 0; c < NUM_COLORS; c++)
+        {
+            keys[c][idx] = cauldron->color == c + COLOR_RED;
+            memcpy(&keys[c][idx + 1], &cauldron->counts[c * NUM_POTION_VALUES], NUM_POTION_VALUES);
+        }
+        idx += COLOR_KEY_CAULDRON;
+    }
+
+    // positions hold value index + 1 so an empty slot differs from the lowest potion
+    for (uint8_t i = state->deck_pos; i < state->deck_size; i++)
+    {
+        uint8_t type = state->deck[i];
+        if (type != POISON_TYPE_INDEX)
+            keys[type / NUM_POTION_VALUES][idx + i] = (uint8_t)(type % NUM_POTION_VALUES + 1);
+    }
+    idx += TOTAL_CARDS;
+
+    for (uint8_t p = 0; p < state->num_players; p++)
+    {
+        const Player *player = &state->players[p];
+        for (uint8_t i = 0; i < player->hand_size; i++)
+        {
+            uint8_t type = player->hand[i];
+            if (type != POISON_TYPE_INDEX)
+                keys[type / NUM_POTION_VALUES][idx + p * HAND_CAPACITY + i] = (uint8_t)(type % NUM_POTION_VALUES + 1);
+        }
+    }
+    idx += NUM_PLAYERS_MAX * HAND_CAPACITY;
+
+    for (uint8_t k = 0; k < NUM_CAULDRONS; k++)
+    {
+        const Cauldron *cauldron = &state->cauldrons[k];
+        for (uint8_t i = 0; i < cauldron->num_cards; i++)
+        {
+            uint8_t type = cauldron->cards[i];
+            if (type != POISON_TYPE_INDEX)
+                keys[type / NUM_POTION_VALUES][idx + k * CAULDRON_CAPACITY + i] =
+                    (uint8_t)(type % NUM_POTION_VALUES + 1);
+        }
+    }
+
+    return color_perm_from_keys(keys, COLOR_KEY_SIZE, memcmp);
+}
+
+uint8_t game_canonicalize(const GameState *state, GameState *out)
+{
+    if (!state || !out)
+        return 0;
+
+    uint8_t perm = game_canonical_color_perm(state);
+    game_permute_colors(state, perm, out);
+    return perm;
+}
+
+size_t game_permute_observation(const float *obs, uint8_t perm, float *out, size_t out_len)
+{
+    if (!obs || !out || perm >= GAME_NUM_COLOR_PERMS || out_len < observation_size())
+        return 0;
+
+    uint8_t types[NUM_CARD_TYPES];
+    color_perm_types(perm, types);
+
+    float src[OBS_SIZE];
+    memcpy(src, obs, sizeof(src));
+    memcpy(out, src, sizeof(src));
+
+    for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++)
+    {
+        size_t row = OBS_HEADER_FEATURES + (size_t)slot * OBS_PLAYER_FEATURES;
+        permute_counts_f32(types, &src[row + FEAT_HAND_COUNTS], &out[row + FEAT_HAND_COUNTS]);
+        permute_counts_f32(types, &src[row + FEAT_COLLECTED_COUNTS], &out[row + FEAT_COLLECTED_COUNTS]);
+    }
+
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+    {
+        size_t row = OBS_HEADER_FEATURES + NUM_PLAYERS_MAX * OBS_PLAYER_FEATURES + (size_t)c * OBS_CAULDRON_FEATURES;
+        uint8_t color = (uint8_t)src[row + FEAT_CAULDRON_COLOR];
+        if (color <= COLOR_PURPLE)
+            out[row + FEAT_CAULDRON_COLOR] = color_perm_enum(perm, color);
+        permute_counts_f32(types, &src[row + FEAT_CAULDRON_COUNTS], &out[row + FEAT_CAULDRON_COUNTS]);
+    }
+
+    return observation_size();
+}
+
+uint8_t game_canonicalize_observation(const float *obs, float *out, size_t out_len)
+{
+    if (!obs || !out || out_len < observation_size())
+        return 0;
+
+    float keys[NUM_COLORS][OBS_COLOR_KEY_SIZE];
+    size_t idx = 0;
+
+    for (uint8_t slot = 0; slot < NUM_PLAYERS_MAX; slot++)
+    {
+        const float *row = obs + OBS_HEADER_FEATURES + (size_t)slot * OBS_PLAYER_FEATURES;
+        for (uint8_t c = 0; c < NUM_COLORS; c++)
+        {
+            memcpy(&keys[c][idx], &row[FEAT_HAND_COUNTS + c * NUM_POTION_VALUES], NUM_POTION_VALUES * sizeof(float));
+            memcpy(&keys[c][idx + NUM_POTION_VALUES], &row[FEAT_COLLECTED_COUNTS + c * NUM_POTION_VALUES],
+                   NUM_POTION_VALUES * sizeof(float));
+        }
+        idx += COLOR_KEY_PLAYER;
+    }
+
+    for (uint8_t k = 0; k < NUM_CAULDRONS; k++)
+    {
+        const float *row = obs + OBS_HEADER_FEATURES + NUM_PLAYERS_MAX * OBS_PLAYER_FEATURES +
+                           (size_t)k * OBS_CAULDRON_FEATURES;
+        for (uint8_t c = 0; c < NUM_COLORS; c++)
+        {
+            keys[c][idx] = row[FEAT_CAULDRON_COLOR] == c + COLOR_RED;
+            memcpy(&keys[c][idx + 1], &row[FEAT_CAULDRON_COUNTS + c * NUM_POTION_VALUES],
+                   NUM_POTION_VALUES * sizeof(float));
+        }
+        idx += COLOR_KEY_CAULDRON;
+    }
+
+    uint8_t perm = color_perm_from_keys(keys, sizeof(keys[0]), compare_obs_keys);
+    game_permute_observation(obs, perm, out, out_len);
+    return perm;
+}
+
+uint16_t game_permute_typed_action(uint16_t typed_action, uint8_t perm)
+{
+    if (typed_action >= TYPED_ACTIONS || perm >= GAME_NUM_COLOR_PERMS)
+        return UINT16_MAX;
+
+    uint8_t types[NUM_CARD_TYPES];
+    color_perm_types(perm, types);
+    return (uint16_t)(types[typed_action / NUM_CAULDRONS] * NUM_CAULDRONS + typed_action % NUM_CAULDRONS);
+}
+
+size_t game_permute_typed_action_mask(const uint8_t *mask, uint8_t perm, uint8_t *out, size_t out_len)
+{
+    if (!mask || !out || perm >= GAME_NUM_COLOR_PERMS || out_len < TYPED_ACTIONS)
+        return 0;
+
+    uint8_t types[NUM_CARD_TYPES];
+    color_perm_types(perm, types);
+
+    uint8_t src[TYPED_ACTIONS];
+    memcpy(src, mask, sizeof(src));
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+    {
+        memcpy(&out[types[t] * NUM_CAULDRONS], &src[t * NUM_CAULDRONS], NUM_CAULDRONS);
+    }
+    return TYPED_ACTIONS;
+}
+
+uint64_t game_permute_typed_action_bits(uint64_t bits, uint8_t perm)
+{
+    if (perm >= GAME_NUM_COLOR_PERMS)
+        return 0;
+
+    uint8_t types[NUM_CARD_TYPES];
+    color_perm_types(perm, types);
+
+    uint64_t out = 0;
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+    {
+        uint64_t group = (bits >> (t * NUM_CAULDRONS)) & ((1u << NUM_CAULDRONS) - 1);
+        out |= group << (types[t] * NUM_CAULDRONS);
+    }
+    return out;
+}
+
+struct GameBatch
+{
+    size_t num_envs;
+    uint64_t seed;
+    uint64_t *episodes; // re-deals so far per env, for game_seed_for
+    GameState envs[];
+};
+
+GameBatch *game_batch_create(size_t num_envs, uint8_t num_players, GameVariant variant, uint64_t seed)
+{
+    if (num_envs == 0)
+        return NULL;
+    if (num_players < NUM_PLAYERS_MIN || num_players > NUM_PLAYERS_MAX)
+        return NULL;
+    if (num_envs > (SIZE_MAX - sizeof(GameBatch)) / sizeof(GameState))
+        return NULL;
+
+    GameBatch *batch = aligned_alloc(CACHE_LINE_SIZE, sizeof(*batch) + num_envs * sizeof(GameState));
+    if (!batch)
+        return NULL;
+
+    batch->episodes = calloc(num_envs, sizeof(uint64_t));
+    if (!batch->episodes)
+    {
+        free(batch);
+        return NULL;
+    }
+
+    batch->num_envs = num_envs;
+    batch->seed = seed;
+    for (size_t i = 0; i < num_envs; i++)
+    {
+        game_setup(&batch->envs[i], num_players, variant, game_seed_for(seed, i, 0));
+    }
+
+    return batch;
+}
+
+void game_batch_destroy(GameBatch *batch)
+{
+    if (batch)
+    {
+        free(batch->episodes);
+        free(batch);
+    }
+}
+
+void game_batch_reset(GameBatch *batch)
+{
+    if (!batch)
+        return;
+
+    for (size_t i = 0; i < batch->num_envs; i++)
+    {
+        game_reset(&batch->envs[i]);
+    }
+}
+
+size_t game_batch_size(const GameBatch *batch)
+{
+    return batch ? batch->num_envs : 0;
+}
+
+GameState *game_batch_get_state(GameBatch *batch, size_t env)
+{
+    if (!batch || env >= batch->num_envs)
+        return NULL;
+    return &batch->envs[env];
+}
+
+// episode is NULL for a lone game, which re-deals from its own rng; batch envs
+// pass their re-deal counter and re-deal from game_seed_for(seed, env, episode)
+static void game_step_observe_impl(GameState *state, uint16_t action_id, uint32_t flags, GameObsMode mode,
+                                   GameObsFormat format, uint64_t seed, uint64_t env, uint64_t *episode,
+                                   GameStepOutput *out_result, void *out_obs, uint8_t *out_mask)
+{
+    GameStepOutput result = {0};
+    result.step = game_step_action_impl(state, action_id, NULL);
+    for (uint8_t i = 0; i < state->num_players; i++)
+        result.scores[i] = state->players[i].score;
+
+    if (result.step.done && (flags & GAME_STEP_AUTO_RESET))
+    {
+        result.reset_seed = episode ? game_seed_for(seed, env, ++*episode) : rng_next64(&state->rng);
+        game_setup(state, state->num_players, state->variant, result.reset_seed);
+        result.game_reset = true;
+    }
+    else if (result.step.round_done && !result.step.done && (flags & GAME_STEP_AUTO_ROUND))
+    {
+        game_start_new_round(state);
+        result.round_started = true;
+    }
+
+    if (out_obs)
+    {
+        int16_t features[OBS_SIZE];
+        game_write_observation_i16(state, state->current_player, mode, features);
+        game_encode_observation(features, format, out_obs);
+    }
+    if (out_mask)
+        game_write_legal_action_mask(state, out_mask);
+    if (out_result)
+        *out_result = result;
+}
+
+bool game_step_observe(GameState *state, uint16_t action_id, uint32_t flags, GameObsMode mode, GameObsFormat format,
+                       GameStepOutput *out_result, void *out_obs, size_t obs_bytes, uint8_t *out_mask,
+                       size_t mask_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_STEP_OBSERVE);
+
+    size_t obs_size = game_observation_bytes(format);
+    if (!state || obs_size == 0)
+        return false;
+    if ((out_obs && obs_bytes < obs_size) || (out_mask && mask_len < action_space_size()))
+        return false;
+
+    game_step_observe_impl(state, action_id, flags, mode, format, 0, 0, NULL, out_result, out_obs, out_mask);
+    return true;
+}
+
+size_t game_batch_step(GameBatch *batch, const uint16_t *action_ids, float *out_rewards, bool *out_dones, StepResult *out_results)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_BATCH_STEP);
+
+    if (!batch || !action_ids)
+        return 0;
+
+    for (size_t i = 0; i < batch->num_envs; i++)
+    {
+        StepResult result = game_step_action_impl(&batch->envs[i], action_ids[i], NULL);
+
+        if (out_rewards)
+            out_rewards[i] = result.reward;
+        if (out_dones)
+            out_dones[i] = result.done;
+        if (out_results)
+            out_results[i] = result;
+    }
+
+    return batch->num_envs;
+}
+
+size_t game_batch_get_observations(const GameBatch *batch, GameObsMode mode, float *out, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_BATCH_OBSERVATIONS);
+
+    if (!batch || !out)
+        return 0;
+    const size_t obs_size = observation_size();
+    if (out_len / obs_size < batch->num_envs)
+        return 0;
+
+    size_t written = 0;
+    for (size_t i = 0; i < batch->num_envs; i++)
+    {
+        const GameState *state = &batch->envs[i];
+        written += game_write_observation(state, state->current_player, mode, out + i * obs_size);
+    }
+    return written;
+}
+
+size_t game_batch_step_observe(GameBatch *batch, const uint16_t *action_ids, uint32_t flags, GameObsMode mode,
+                               GameObsFormat format, GameStepOutput *out_results, void *out_obs, size_t obs_bytes,
+                               uint8_t *out_masks, size_t mask_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_BATCH_STEP_OBSERVE);
+
+    size_t obs_size = game_observation_bytes(format);
+    size_t mask_size = action_space_size();
+    if (!batch || !action_ids || obs_size == 0)
+        return 0;
+    if (out_obs && obs_bytes / obs_size < batch->num_envs)
+        return 0;
+    if (out_masks && mask_len / mask_size < batch->num_envs)
+        return 0;
+
+    uint8_t *obs = out_obs;
+    for (size_t i = 0; i < batch->num_envs; i++)
+    {
+        game_step_observe_impl(&batch->envs[i], action_ids[i], flags, mode, format, batch->seed, i,
+                               &batch->episodes[i], out_results ? &out_results[i] : NULL,
+                               obs ? obs + i * obs_size : NULL, out_masks ? out_masks + i * mask_size : NULL);
+    }
+    return batch->num_envs;
+}
+
+size_t game_batch_get_observations_encoded(const GameBatch *batch, GameObsMode mode, GameObsFormat format, void *out,
+                                           size_t out_bytes)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_BATCH_OBSERVATIONS);
+
+    size_t obs_bytes = game_observation_bytes(format);
+    if (!batch || !out || obs_bytes == 0)
+        return 0;
+    if (out_bytes / obs_bytes < batch->num_envs)
+        return 0;
+
+    uint8_t *dst = out;
+    int16_t features[OBS_SIZE];
+    for (size_t i = 0; i < batch->num_envs; i++)
+    {
+        const GameState *state = &batch->envs[i];
+        game_write_observation_i16(state, state->current_player, mode, features);
+        game_encode_observation(features, format, dst + i * obs_bytes);
+    }
+    return batch->num_envs * obs_bytes;
+}
+
+size_t game_batch_get_legal_action_masks(const GameBatch *batch, uint8_t *out_masks, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_BATCH_MASKS);
+
+    if (!batch || !out_masks)
+        return 0;
+    const uint16_t action_space = action_space_size();
+    if (out_len / action_space < batch->num_envs)
+        return 0;
+
+    size_t count = 0;
+    for (size_t i = 0; i < batch->num_envs; i++)
+    {
+        count += game_write_legal_action_mask(&batch->envs[i], out_masks + i * action_space);
+    }
+    return count;
+}
+
+size_t game_batch_get_typed_legal_action_masks(const GameBatch *batch, uint8_t *out_masks, size_t out_len)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_BATCH_MASKS);
+
+    if (!batch || !out_masks)
+        return 0;
+    if (out_len / TYPED_ACTIONS < batch->num_envs)
+        return 0;
+
+    size_t count = 0;
+    for (size_t i = 0; i < batch->num_envs; i++)
+    {
+        count += game_write_typed_legal_mask(&batch->envs[i], out_masks + i * TYPED_ACTIONS);
+    }
+    return count;
+}
+
+struct GamePool
+{
+    GameState *slots;
+    size_t capacity;
+    size_t free_count;
+    uint32_t free_list[];
+};
+
+GamePool *game_pool_create(size_t capacity)
+{
+    if (capacity == 0 || capacity > UINT32_MAX)
+        return NULL;
+    if (capacity > (SIZE_MAX - sizeof(GamePool)) / sizeof(uint32_t))
+        return NULL;
+    if (capacity > SIZE_MAX / sizeof(GameState))
+        return NULL;
+
+    GamePool *pool = malloc(sizeof(*pool) + capacity * sizeof(uint32_t));
+    if (!pool)
+        return NULL;
+
+    pool->slots = aligned_alloc(CACHE_LINE_SIZE, capacity * sizeof(GameState));
+    if (!pool->slots)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pool->capacity = capacity;
+    pool->free_count = capacity;
+    // hand out low slots first so a lightly used pool stays compact
+    for (size_t i = 0; i < capacity; i++)
+    {
+        pool->free_list[i] = (uint32_t)(capacity - 1 - i);
+    }
+
+    return pool;
+}
+
+void game_pool_destroy(GamePool *pool)
+{
+    if (pool)
+    {
+        free(pool->slots);
+        free(pool);
+    }
+}
+
+GameState *game_pool_acquire(GamePool *pool)
+{
+    if (!pool || pool->free_count == 0)
+        return NULL;
+
+    return &pool->slots[pool->free_list[--pool->free_count]];
+}
+
+void game_pool_release(GamePool *pool, GameState *state)
+{
+    if (!pool || !state)
+        return;
+    if (state < pool->slots || state >= pool->slots + pool->capacity)
+        return;
+    if (pool->free_count >= pool->capacity)
+        return;
+
+    pool->free_list[pool->free_count++] = (uint32_t)(state - pool->slots);
+}
+
+size_t game_pool_available(const GamePool *pool)
+{
+    return pool ? pool->free_count : 0;
+}
+
+#define DETERMINIZE_MAX_ATTEMPTS 256
+
+typedef struct
+{
+    uint8_t cards[TOTAL_CARDS];
+    uint8_t num_cards;
+    uint8_t seats[NUM_PLAYERS_MAX];
+    uint16_t allowed[NUM_PLAYERS_MAX];
+    uint8_t num_seats;
+} HiddenCards;
+
+static uint16_t game_void_color_types(uint8_t void_colors)
+{
+    uint16_t types = 0;
+    for (Color color = COLOR_RED; color <= COLOR_PURPLE; color++)
+    {
+        if (void_colors & (1u << color))
+            types |= (uint16_t)(((1u << NUM_POTION_VALUES) - 1) << (game_color_index(color) * NUM_POTION_VALUES));
+    }
+    return types;
+}
+
+// the cards `perspective` cannot see, and the seats holding some of them
+static void game_collect_hidden(const GameState *state, uint8_t perspective, const uint8_t *void_colors, HiddenCards *hidden)
+{
+    hidden->num_cards = 0;
+    for (uint8_t t = 0; t < NUM_CARD_TYPES; t++)
+    {
+        int count = DECK_TYPE_COUNTS[t] - state->players[perspective].hand_counts[t];
+        for (uint8_t p = 0; p < state->num_players; p++)
+        {
+            count -= state->players[p].collected_counts[t];
+        }
+        for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+        {
+            count -= state->cauldrons[c].counts[t];
+        }
+        for (int k = 0; k < count; k++)
+        {
+            hidden->cards[hidden->num_cards++] = t;
+        }
+    }
+
+    hidden->num_seats = 0;
+    for (uint8_t p = 0; p < state->num_players; p++)
+    {
+        if (p == perspective || state->players[p].hand_size == 0)
+            continue;
+
+        uint16_t allowed = (uint16_t)((1u << NUM_CARD_TYPES) - 1);
+        if (void_colors)
+            allowed &= (uint16_t)~game_void_color_types(void_colors[p]);
+
+        hidden->seats[hidden->num_seats] = p;
+        hidden->allowed[hidden->num_seats] = allowed;
+        hidden->num_seats++;
+    }
+}
+
+// deals hidden cards into `hands` (one run per seat, in hidden->seats order)
+// followed by the undealt deck. Seats are filled tightest-first, i.e. the seat
+// with the fewest spare allowed cards left; false if a seat could not be filled
+static bool game_sample_hidden(const GameState *state, const HiddenCards *hidden, uint8_t *hands, GameRng *rng)
+{
+    uint8_t pool[TOTAL_CARDS];
+    uint8_t pool_size = hidden->num_cards;
+    uint8_t offsets[NUM_PLAYERS_MAX];
+    bool filled[NUM_PLAYERS_MAX] = {false};
+
+    memcpy(pool, hidden->cards, pool_size);
+
+    uint8_t offset = 0;
+    for (uint8_t s = 0; s < hidden->num_seats; s++)
+    {
+        offsets[s] = offset;
+        offset += state->players[hidden->seats[s]].hand_size;
+    }
+
+    for (uint8_t round = 0; round < hidden->num_seats; round++)
+    {
+        int best_slack = TOTAL_CARDS + 1;
+        uint8_t seat = 0;
+        for (uint8_t s = 0; s < hidden->num_seats; s++)
+        {
+            if (filled[s])
+                continue;
+
+            int available = 0;
+            for (uint8_t i = 0; i < pool_size; i++)
+            {
+                available += (hidden->allowed[s] >> pool[i]) & 1;
+            }
+            int slack = available - state->players[hidden->seats[s]].hand_size;
+            if (slack < best_slack)
+            {
+                best_slack = slack;
+                seat = s;
+            }
+        }
+        if (best_slack < 0)
+            return false;
+
+        filled[seat] = true;
+        uint16_t allowed = hidden->allowed[seat];
+        uint8_t hand_size = state->players[hidden->seats[seat]].hand_size;
+        uint8_t candidates = (uint8_t)(best_slack + hand_size);
+
+        for (uint8_t k = 0; k < hand_size; k++)
+        {
+            uint8_t target = (uint8_t)rng_bounded(rng, candidates--);
+            uint8_t pick = 0;
+            for (;; pick++)
+            {
+                if (((allowed >> pool[pick]) & 1) && target-- == 0)
+                    break;
+            }
+
+            hands[offsets[seat] + k] = pool[pick];
+            pool[pick] = pool[--pool_size];
+        }
+    }
+
+    for (uint8_t i = pool_size; i > 1; i--)
+    {
+        uint8_t j = (uint8_t)rng_bounded(rng, i);
+        uint8_t temp = pool[i - 1];
+        pool[i - 1] = pool[j];
+        pool[j] = temp;
+    }
+    memcpy(&hands[offset], pool, pool_size);
+    return true;
+}
+
+size_t game_determinize(const GameState *state, uint8_t perspective, const uint8_t *void_colors,
+                        GameState *const *out_states, size_t count, GameRng *rng)
+{
+    GAME_PROFILE_SCOPE(GAME_PROFILE_DETERMINIZE);
+
+    if (!state || !out_states || !rng || perspective >= state->num_players)
+        return 0;
+
+    HiddenCards hidden;
+    game_collect_hidden(state, perspective, void_colors, &hidden);
+
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        GameState *out = out_states[written];
+        if (!out)
+            break;
+
+        uint8_t cards[TOTAL_CARDS];
+        bool ok = false;
+        for (uint16_t attempt = 0; attempt < DETERMINIZE_MAX_ATTEMPTS && !ok; attempt++)
+        {
+            ok = game_sample_hidden(state, &hidden, cards, rng);
+        }
+        if (!ok)
+            continue;
+
+        game_copy_into(out, state);
+
+        uint8_t pos = 0;
+        for (uint8_t s = 0; s < hidden.num_seats; s++)
+        {
+            uint8_t seat = hidden.seats[s];
+            uint8_t hand_size = state->players[seat].hand_size;
+            game_set_player_hand(out, seat, &cards[pos], hand_size);
+            pos += hand_size;
+        }
+
+        for (uint8_t d = state->deck_pos; d < state->deck_size && pos < hidden.num_cards; d++)
+        {
+            out->deck[d] = cards[pos++];
+        }
+        out->hash = game_compute_hash(out);
+
+        written++;
+    }
+
+    return written;
 }
@@ -0,0 +1,160 @@
+#ifndef POISON_INTERNAL_H
+#define POISON_INTERNAL_H
+
+// engine state layout shared by the modules in src/; not part of the public API
+
+#include "poison.h"
+
+#define TOTAL_CARDS 50
+#define NUM_POISON_CARDS 8
+#define NUM_COLORS 3
+#define NUM_POTION_VALUES 5
+#define POISON_TYPE_INDEX (NUM_CARD_TYPES - 1)
+#define TYPED_ACTIONS (NUM_CARD_TYPES * NUM_CAULDRONS)
+#define HAND_SIZE_DRAW 5
+#define HAND_CAPACITY 16
+#define CAULDRON_CAPACITY 16
+#define LEGAL_ACTION_WORDS ((TOTAL_CARDS * NUM_CAULDRONS + 63) / 64)
+#define CACHE_LINE_SIZE 64
+
+_Static_assert(NUM_CARD_TYPES == NUM_COLORS * NUM_POTION_VALUES + 1, "one type per potion plus poison");
+_Static_assert(TYPED_ACTIONS <= 64, "typed actions must fit in one word");
+
+#define OBS_HEADER_FEATURES 6
+#define OBS_PLAYER_FEATURES (3 + 2 * NUM_CARD_TYPES)
+#define OBS_CAULDRON_FEATURES (3 + NUM_CARD_TYPES)
+#define OBS_SIZE (OBS_HEADER_FEATURES + NUM_PLAYERS_MAX * OBS_PLAYER_FEATURES + NUM_CAULDRONS * OBS_CAULDRON_FEATURES)
+#define FEAT_HAND_SIZE 0
+#define FEAT_COLLECTED_SIZE 1
+#define FEAT_SCORE 2
+#define FEAT_HAND_COUNTS 3
+#define FEAT_COLLECTED_COUNTS (FEAT_HAND_COUNTS + NUM_CARD_TYPES)
+#define FEAT_CAULDRON_TOTAL 0
+#define FEAT_CAULDRON_NUM_CARDS 1
+#define FEAT_CAULDRON_COLOR 2
+#define FEAT_CAULDRON_COUNTS 3
+
+// card type index -> card, ordered red, blue, purple by potion value, then poison
+extern const Card CARD_TYPES[NUM_CARD_TYPES];
+// copies of each card type in a full 50-card deck
+extern const uint8_t DECK_TYPE_COUNTS[NUM_CARD_TYPES];
+
+// cards are stored as card type indices; hands and cauldrons keep their
+// order for positional access, collected piles are histograms only
+typedef struct
+{
+    uint8_t cards[CAULDRON_CAPACITY];
+    uint8_t counts[NUM_CARD_TYPES];
+    uint8_t num_cards;
+    uint8_t total_value;
+    uint8_t color;
+} Cauldron;
+
+typedef struct
+{
+    uint8_t hand[HAND_CAPACITY];
+    uint8_t hand_counts[NUM_CARD_TYPES];
+    uint8_t collected_counts[NUM_CARD_TYPES];
+    uint8_t hand_size;
+    uint8_t collected_size;
+    int32_t score;
+} Player;
+
+// cache-line aligned so pooled and batched states never share a line
+struct GameState
+{
+    _Alignas(CACHE_LINE_SIZE) Player players[NUM_PLAYERS_MAX];
+    Cauldron cauldrons[NUM_CAULDRONS];
+    uint8_t num_players;
+    uint8_t current_player;
+    uint8_t dealer;
+    uint8_t round;
+    bool game_over;
+    bool round_scored;
+    uint8_t cards_in_hands;
+    GameVariant variant;
+    uint8_t deck[TOTAL_CARDS];
+    uint8_t deck_size;
+    uint8_t deck_pos;
+    GameRng rng;
+    uint64_t hash;
+    // observation rows kept in sync with players/cauldrons, in absolute seat order
+    int16_t player_features[NUM_PLAYERS_MAX][OBS_PLAYER_FEATURES];
+    int16_t cauldron_features[NUM_CAULDRONS][OBS_CAULDRON_FEATURES];
+};
+
+#define RNG_MULTIPLIER 6364136223846793005ull
+
+// SplitMix64 finaliser, used to spread seeds before they enter the LCG
+static inline uint64_t rng_mix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static inline uint32_t rng_next(GameRng *rng)
+{
+    uint64_t old = rng->state;
+    rng->state = old * RNG_MULTIPLIER + rng->inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+static inline uint64_t rng_next64(GameRng *rng)
+{
+    uint64_t hi = rng_next(rng);
+    return hi << 32 | rng_next(rng);
+}
+
+static inline void rng_seed(GameRng *rng, uint64_t seed, uint64_t stream)
+{
+    rng->state = 0;
+    rng->inc = stream << 1 | 1u;
+    rng_next(rng);
+    rng->state += rng_mix64(seed);
+    rng_next(rng);
+}
+
+// Lemire's multiply-shift; the rare low products below 2^32 % bound are redrawn
+static inline uint32_t rng_bounded(GameRng *rng, uint32_t bound)
+{
+    uint64_t product = (uint64_t)rng_next(rng) * bound;
+    uint32_t low = (uint32_t)product;
+    if (low < bound)
+    {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold)
+        {
+            product = (uint64_t)rng_next(rng) * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return (uint32_t)(product >> 32);
+}
+
+// replaces a player's hand, keeping histograms and observation rows in sync
+void game_set_player_hand(GameState *state, uint8_t player, const uint8_t *types, uint8_t count);
+
+#ifdef POISON_PROFILE
+#include "poison_profile.h"
+
+typedef struct
+{
+    GameProfilePoint point;
+    uint64_t start;
+} GameProfileScope;
+
+uint64_t game_profile_ticks(void);
+void game_profile_scope_end(GameProfileScope *scope);
+
+// times the rest of the enclosing block, whichever way it is left
+#define GAME_PROFILE_SCOPE(point) \
+    GameProfileScope game_profile_scope __attribute__((cleanup(game_profile_scope_end))) = {(point), game_profile_ticks()}
+#else
+#define GAME_PROFILE_SCOPE(point) ((void)0)
+#endif
+
+#endif // POISON_INTERNAL_H
@@ -0,0 +1,210 @@
+#include "poison_policy.h"
+#include "poison_internal.h"
+
+#include <string.h>
+
+static const char *const POLICY_NAMES[POLICY_NUM_KINDS] = {
+    "random", "min_collect", "avoid_overflow", "poison_dump", "lookahead",
+};
+
+// per-decision view of the table: what each cauldron would hand the mover on
+// an overflow, and (for POLICY_LOOKAHEAD) the mover's round score either way
+typedef struct
+{
+    uint8_t total[NUM_CAULDRONS];
+    uint8_t collected[NUM_CAULDRONS];
+    uint8_t collected_poison[NUM_CAULDRONS];
+    int32_t overflow_score[NUM_CAULDRONS];
+    int32_t base_score;
+} PolicyTable;
+
+const char *policy_name(PolicyKind kind)
+{
+    return kind < POLICY_NUM_KINDS ? POLICY_NAMES[kind] : "unknown";
+}
+
+bool policy_from_name(const char *name, PolicyKind *out_kind)
+{
+    if (!name || !out_kind)
+        return false;
+
+    for (int kind = 0; kind < POLICY_NUM_KINDS; kind++)
+    {
+        if (strcmp(name, POLICY_NAMES[kind]) == 0)
+        {
+            *out_kind = (PolicyKind)kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+// the mover's round score if the round ended now, after taking extra cards of
+// colour index extra_color; a colour is immune when the mover holds strictly
+// more of it than anyone else
+static int32_t policy_round_score(const int32_t *own, const int32_t *others_max, int32_t poison, int extra_color,
+                                  int32_t extra)
+{
+    int32_t score = -2 * poison;
+    for (int c = 0; c < NUM_COLORS; c++)
+    {
+        int32_t count = own[c] + (c == extra_color ? extra : 0);
+        if (count <= others_max[c])
+            score -= count;
+    }
+    return score;
+}
+
+static void policy_prepare_lookahead(const GameState *state, PolicyTable *table)
+{
+    uint8_t mover = state->current_player;
+    int32_t own[NUM_COLORS] = {0};
+    int32_t others_max[NUM_COLORS] = {0};
+
+    for (uint8_t p = 0; p < state->num_players; p++)
+    {
+        const uint8_t *counts = state->players[p].collected_counts;
+        for (uint8_t c = 0; c < NUM_COLORS; c++)
+        {
+            int32_t count = 0;
+            for (uint8_t v = 0; v < NUM_POTION_VALUES; v++)
+            {
+                count += counts[c * NUM_POTION_VALUES + v];
+            }
+
+            if (p == mover)
+                own[c] = count;
+            else if (count > others_max[c])
+                others_max[c] = count;
+        }
+    }
+
+    int32_t poison = state->players[mover].collected_counts[POISON_TYPE_INDEX];
+    table->base_score = policy_round_score(own, others_max, poison, -1, 0);
+    for (uint8_t k = 0; k < NUM_CAULDRONS; k++)
+    {
+        const Cauldron *cauldron = &state->cauldrons[k];
+        int color = cauldron->color == COLOR_NONE ? -1 : cauldron->color - COLOR_RED;
+        table->overflow_score[k] =
+            policy_round_score(own, others_max, poison + table->collected_poison[k], color,
+                               table->collected[k] - table->collected_poison[k]);
+    }
+}
+
+static void policy_prepare(PolicyKind kind, const GameState *state, PolicyTable *table)
+{
+    for (uint8_t k = 0; k < NUM_CAULDRONS; k++)
+    {
+        const Cauldron *cauldron = &state->cauldrons[k];
+        table->total[k] = cauldron->total_value;
+        table->collected[k] = cauldron->num_cards;
+        table->collected_poison[k] = cauldron->counts[POISON_TYPE_INDEX];
+    }
+
+    if (kind == POLICY_LOOKAHEAD)
+        policy_prepare_lookahead(state, table);
+}
+
+// higher is better; the cost of an overflow counts poison twice, as scoring does
+static int32_t policy_score(PolicyKind kind, const PolicyTable *table, uint8_t typed_action)
+{
+    uint8_t type = (uint8_t)(typed_action / NUM_CAULDRONS);
+    uint8_t k = (uint8_t)(typed_action % NUM_CAULDRONS);
+    int32_t value = CARD_TYPES[type].value;
+    int32_t total = table->total[k];
+    bool poison = type == POISON_TYPE_INDEX;
+    bool overflow = total + value > CAULDRON_THRESHOLD;
+    int32_t cost = overflow ? table->collected[k] + table->collected_poison[k] : 0;
+
+    switch (kind)
+    {
+    case POLICY_MIN_COLLECT:
+        return -32 * (overflow ? table->collected[k] : 0) + value;
+    case POLICY_AVOID_OVERFLOW:
+        if (!overflow)
+            return 1024 + 16 * total + value;
+        return -32 * cost + value;
+    case POLICY_POISON_DUMP:
+        if (!overflow)
+            return (poison ? 2048 : 1024) + 16 * total + value;
+        // an overflowing poison stays behind in the cauldron for the next player
+        return -32 * cost + (poison ? 16 : 0) + value;
+    case POLICY_LOOKAHEAD:
+        if (!overflow)
+            return 1024 * table->base_score + 32 + total + (poison ? 16 : 0) + value;
+        return 1024 * table->overflow_score[k] + (poison ? 16 : 0) + value;
+    default:
+        return 0;
+    }
+}
+
+uint16_t policy_act(PolicyKind kind, const GameState *state, GameRng *rng)
+{
+    if (!state || kind >= POLICY_NUM_KINDS)
+        return 0;
+
+    if (kind == POLICY_RANDOM)
+    {
+        if (rng)
+            return game_sample_legal_action(state, rng);
+        uint64_t words[LEGAL_ACTION_WORDS] = {0};
+        game_get_legal_action_bits(state, words, LEGAL_ACTION_WORDS);
+        return words[0] ? (uint16_t)__builtin_ctzll(words[0]) : 0;
+    }
+
+    uint64_t bits = 0;
+    if (!game_get_typed_legal_action_bits(state, &bits))
+        return 0;
+
+    PolicyTable table;
+    policy_prepare(kind, state, &table);
+
+    uint8_t best = 0;
+    int32_t best_score = INT32_MIN;
+    uint32_t ties = 0;
+    while (bits)
+    {
+        uint8_t typed_action = (uint8_t)__builtin_ctzll(bits);
+        bits &= bits - 1;
+
+        int32_t score = policy_score(kind, &table, typed_action);
+        if (score > best_score)
+        {
+            best = typed_action;
+            best_score = score;
+            ties = 1;
+        }
+        else if (score == best_score && rng && rng_bounded(rng, ++ties) == 0)
+        {
+            best = typed_action;
+        }
+    }
+
+    return game_typed_to_action(state, best);
+}
+
+size_t policy_act_batch(PolicyKind kind, const GameState *const *states, size_t count, GameRng *rng,
+                        uint16_t *out_actions)
+{
+    if (!states || !out_actions)
+        return 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        out_actions[i] = policy_act(kind, states[i], rng);
+    }
+    return count;
+}
+
+size_t policy_act_game_batch(PolicyKind kind, GameBatch *batch, GameRng *rng, uint16_t *out_actions)
+{
+    if (!batch || !out_actions)
+        return 0;
+
+    size_t count = game_batch_size(batch);
+    for (size_t i = 0; i < count; i++)
+    {
+        out_actions[i] = policy_act(kind, game_batch_get_state(batch, i), rng);
+    }
+    return count;
+}
@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "poison_profile.h"
+#include "poison_internal.h"
+
+#include <string.h>
+
+static const char *const PROFILE_POINT_NAMES[GAME_PROFILE_NUM_POINTS] = {
+    "game_init",
+    "game_reset",
+    "game_clone",
+    "game_copy_into",
+    "game_step_action",
+    "game_step_with_undo",
+    "game_step_observe",
+    "game_step_typed_action",
+    "game_undo",
+    "game_start_new_round",
+    "game_get_observation",
+    "game_get_observation_encoded",
+    "game_get_observations_all",
+    "game_get_legal_action_mask",
+    "game_get_legal_action_bits",
+    "game_get_typed_legal_action_mask",
+    "game_get_typed_legal_action_bits",
+    "game_sample_legal_action",
+    "game_batch_step",
+    "game_batch_step_observe",
+    "game_batch_get_observations",
+    "game_batch_get_legal_action_masks",
+    "game_determinize",
+};
+
+const char *game_profile_point_name(GameProfilePoint point)
+{
+    if ((unsigned)point >= GAME_PROFILE_NUM_POINTS)
+        return "unknown";
+    return PROFILE_POINT_NAMES[point];
+}
+
+#ifdef POISON_PROFILE
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_TICK_UNIT "cycles"
+#else
+#define PROFILE_TICK_UNIT "ns"
+#endif
+
+// counters are written only by their owning thread; relaxed atomics let the
+// snapshot read them concurrently without locks or torn values
+typedef struct
+{
+    _Atomic uint64_t calls;
+    _Atomic uint64_t total_ticks;
+    _Atomic uint64_t max_ticks;
+    _Atomic uint64_t histogram[GAME_PROFILE_BUCKETS];
+} ProfileCounters;
+
+typedef struct ProfileThread
+{
+    ProfileCounters counters[GAME_PROFILE_NUM_POINTS];
+    struct ProfileThread *next;
+} ProfileThread;
+
+// blocks are never freed, so counts outlive the threads that produced them
+static _Atomic(ProfileThread *) profile_threads = NULL;
+static _Thread_local ProfileThread *profile_local = NULL;
+
+uint64_t game_profile_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static ProfileThread *profile_thread(void)
+{
+    if (profile_local)
+        return profile_local;
+
+    ProfileThread *block = calloc(1, sizeof(*block));
+    if (!block)
+        return NULL;
+
+    ProfileThread *head = atomic_load_explicit(&profile_threads, memory_order_relaxed);
+    do
+    {
+        block->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&profile_threads, &head, block, memory_order_release,
+                                                    memory_order_relaxed));
+
+    profile_local = block;
+    return block;
+}
+
+static void counter_add(_Atomic uint64_t *counter, uint64_t value)
+{
+    uint64_t current = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, current + value, memory_order_relaxed);
+}
+
+void game_profile_scope_end(GameProfileScope *scope)
+{
+    uint64_t ticks = game_profile_ticks() - scope->start;
+    ProfileThread *block = profile_thread();
+    if (!block)
+        return;
+
+    ProfileCounters *counters = &block->counters[scope->point];
+    unsigned bucket = ticks ? 63u - (unsigned)__builtin_clzll(ticks) : 0;
+    if (bucket >= GAME_PROFILE_BUCKETS)
+        bucket = GAME_PROFILE_BUCKETS - 1;
+
+    counter_add(&counters->calls, 1);
+    counter_add(&counters->total_ticks, ticks);
+    counter_add(&counters->histogram[bucket], 1);
+    if (ticks > atomic_load_explicit(&counters->max_ticks, memory_order_relaxed))
+        atomic_store_explicit(&counters->max_ticks, ticks, memory_order_relaxed);
+}
+
+bool game_profile_snapshot(GameProfileSnapshot *out)
+{
+    if (!out)
+        return false;
+
+    memset(out, 0, sizeof(*out));
+    out->enabled = true;
+    out->tick_unit = PROFILE_TICK_UNIT;
+
+    for (ProfileThread *block = atomic_load_explicit(&profile_threads, memory_order_acquire); block;
+         block = block->next)
+    {
+        for (int p = 0; p < GAME_PROFILE_NUM_POINTS; p++)
+        {
+            const ProfileCounters *counters = &block->counters[p];
+            GameProfileEntry *entry = &out->entries[p];
+
+            entry->calls += atomic_load_explicit(&counters->calls, memory_order_relaxed);
+            entry->total_ticks += atomic_load_explicit(&counters->total_ticks, memory_order_relaxed);
+            uint64_t max_ticks = atomic_load_explicit(&counters->max_ticks, memory_order_relaxed);
+            if (max_ticks > entry->max_ticks)
+                entry->max_ticks = max_ticks;
+            for (int b = 0; b < GAME_PROFILE_BUCKETS; b++)
+                entry->histogram[b] += atomic_load_explicit(&counters->histogram[b], memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+// increments racing with a reset on another thread may survive it
+void game_profile_reset(void)
+{
+    for (ProfileThread *block = atomic_load_explicit(&profile_threads, memory_order_acquire); block;
+         block = block->next)
+    {
+        for (int p = 0; p < GAME_PROFILE_NUM_POINTS; p++)
+        {
+            ProfileCounters *counters = &block->counters[p];
+            atomic_store_explicit(&counters->calls, 0, memory_order_relaxed);
+            atomic_store_explicit(&counters->total_ticks, 0, memory_order_relaxed);
+            atomic_store_explicit(&counters->max_ticks, 0, memory_order_relaxed);
+            for (int b = 0; b < GAME_PROFILE_BUCKETS; b++)
+                atomic_store_explicit(&counters->histogram[b], 0, memory_order_relaxed);
+        }
+    }
+}
+
+#else
+
+bool game_profile_snapshot(GameProfileSnapshot *out)
+{
+    if (!out)
+        return false;
+
+    memset(out, 0, sizeof(*out));
+    out->tick_unit = "none";
+    return false;
+}
+
+void game_profile_reset(void)
+{
+}
+
+#endif
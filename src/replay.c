@@ -0,0 +1,581 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "poison_replay.h"
+#include "poison_internal.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// file:    header | game records ... | index trailer
+// header:  magic[8] version:u32 obs_size:u32
+// record:  seed:u64 players:u8 variant:u8 flags:u8 obs_mode:u8 steps:u32 action_bytes:u32
+//          actions (bit-packed ranks, padded to 4) | rewards f32[steps] | obs f32[steps][obs_size]
+// trailer: offsets:u64[count] count:u64 index_offset:u64 magic[8]
+#define REPLAY_MAGIC "PSNREPL1"
+#define REPLAY_INDEX_MAGIC "PSNRIDX1"
+#define REPLAY_MAGIC_LEN 8
+#define REPLAY_VERSION 2
+#define REPLAY_HEADER_SIZE 16
+#define REPLAY_RECORD_HEADER_SIZE 20
+#define REPLAY_TRAILER_SIZE 24
+
+typedef struct
+{
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} ReplayBuffer;
+
+struct ReplayWriter
+{
+    FILE *file;
+    uint32_t flags;
+    GameObsMode obs_mode;
+    uint64_t offset;
+    uint64_t *index;
+    size_t num_games;
+    size_t index_capacity;
+
+    // game being recorded
+    bool in_game;
+    bool failed;
+    uint64_t seed;
+    uint8_t num_players;
+    GameVariant variant;
+    uint32_t num_steps;
+    uint64_t bit_pos;
+    ReplayBuffer actions;
+    ReplayBuffer rewards;
+    ReplayBuffer observations;
+};
+
+struct ReplayReader
+{
+    const uint8_t *map;
+    size_t map_size;
+    uint64_t *offsets;
+    size_t num_games;
+};
+
+static bool buffer_reserve(ReplayBuffer *buffer, size_t extra)
+{
+    if (buffer->size + extra <= buffer->capacity)
+        return true;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 256;
+    while (capacity < buffer->size + extra)
+        capacity *= 2;
+
+    uint8_t *data = realloc(buffer->data, capacity);
+    if (!data)
+        return false;
+
+    memset(data + buffer->capacity, 0, capacity - buffer->capacity);
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static bool buffer_append(ReplayBuffer *buffer, const void *src, size_t len)
+{
+    if (!buffer_reserve(buffer, len))
+        return false;
+    memcpy(buffer->data + buffer->size, src, len);
+    buffer->size += len;
+    return true;
+}
+
+static void buffer_reset(ReplayBuffer *buffer)
+{
+    if (buffer->data)
+        memset(buffer->data, 0, buffer->capacity);
+    buffer->size = 0;
+}
+
+static void put_u32(uint8_t *dst, uint32_t value)
+{
+    memcpy(dst, &value, sizeof(value));
+}
+
+static void put_u64(uint8_t *dst, uint64_t value)
+{
+    memcpy(dst, &value, sizeof(value));
+}
+
+static uint32_t get_u32(const uint8_t *src)
+{
+    uint32_t value;
+    memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t *src)
+{
+    uint64_t value;
+    memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+static size_t pad4(size_t size)
+{
+    return (size + 3) & ~(size_t)3;
+}
+
+// bits needed to store a rank among count legal actions
+static unsigned rank_bits(unsigned count)
+{
+    return count <= 1 ? 0 : 32u - (unsigned)__builtin_clz(count - 1);
+}
+
+static unsigned legal_count(const uint64_t *words)
+{
+    unsigned count = 0;
+    for (size_t w = 0; w < LEGAL_ACTION_WORDS; w++)
+        count += (unsigned)__builtin_popcountll(words[w]);
+    return count;
+}
+
+static unsigned action_rank(const uint64_t *words, uint16_t action_id)
+{
+    unsigned rank = 0;
+    for (size_t w = 0; w < action_id / 64u; w++)
+        rank += (unsigned)__builtin_popcountll(words[w]);
+    uint64_t below = (1ull << (action_id % 64u)) - 1;
+    return rank + (unsigned)__builtin_popcountll(words[action_id / 64u] & below);
+}
+
+static uint16_t action_from_rank(const uint64_t *words, unsigned rank)
+{
+    for (size_t w = 0; w < LEGAL_ACTION_WORDS; w++)
+    {
+        unsigned count = (unsigned)__builtin_popcountll(words[w]);
+        if (rank < count)
+        {
+            uint64_t rest = words[w];
+            while (rank--)
+                rest &= rest - 1;
+            return (uint16_t)(w * 64 + (unsigned)__builtin_ctzll(rest));
+        }
+        rank -= count;
+    }
+    return 0;
+}
+
+// pre-step legal set; an empty set means the mover can only pass
+static void replay_legal_words(const GameState *state, uint64_t *words)
+{
+    if (state->players[state->current_player].hand_size == 0)
+    {
+        memset(words, 0, LEGAL_ACTION_WORDS * sizeof(uint64_t));
+        return;
+    }
+    game_get_legal_action_bits(state, words, LEGAL_ACTION_WORDS);
+}
+
+ReplayWriter *replay_writer_open(const char *path, uint32_t flags, GameObsMode obs_mode)
+{
+    if (!path)
+        return NULL;
+
+    ReplayWriter *writer = calloc(1, sizeof(*writer));
+    if (!writer)
+        return NULL;
+
+    writer->file = fopen(path, "wb");
+    if (!writer->file)
+    {
+        free(writer);
+        return NULL;
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    memcpy(header, REPLAY_MAGIC, REPLAY_MAGIC_LEN);
+    put_u32(header + 8, REPLAY_VERSION);
+    put_u32(header + 12, (uint32_t)game_observation_size());
+    if (fwrite(header, sizeof(header), 1, writer->file) != 1)
+    {
+        fclose(writer->file);
+        free(writer);
+        return NULL;
+    }
+
+    writer->flags = flags & (REPLAY_RECORD_REWARDS | REPLAY_RECORD_OBSERVATIONS);
+    writer->obs_mode = obs_mode;
+    writer->offset = REPLAY_HEADER_SIZE;
+    return writer;
+}
+
+bool replay_writer_begin_game(ReplayWriter *writer, const GameState *state, uint64_t seed)
+{
+    if (!writer || !state)
+        return false;
+
+    GameState fresh;
+    if (!game_init_into(&fresh, state->num_players, state->variant, seed))
+        return false;
+    if (fresh.hash != state->hash)
+        return false;
+
+    writer->in_game = true;
+    writer->failed = false;
+    writer->seed = seed;
+    writer->num_players = state->num_players;
+    writer->variant = state->variant;
+    writer->num_steps = 0;
+    writer->bit_pos = 0;
+    buffer_reset(&writer->actions);
+    buffer_reset(&writer->rewards);
+    buffer_reset(&writer->observations);
+    return true;
+}
+
+StepResult replay_writer_step(ReplayWriter *writer, GameState *state, uint16_t action_id)
+{
+    StepResult result = {0};
+    result.winner = -1;
+    if (!writer || !state || !writer->in_game || state->game_over)
+        return result;
+
+    uint64_t words[LEGAL_ACTION_WORDS];
+    replay_legal_words(state, words);
+    unsigned count = legal_count(words);
+    if (count > 0 && (action_id >= game_action_space_size() || !(words[action_id / 64u] >> (action_id % 64u) & 1)))
+        return result;
+
+    unsigned bits = rank_bits(count);
+    if (!buffer_reserve(&writer->actions, (size_t)((writer->bit_pos + bits) / 8 + 1) - writer->actions.size))
+    {
+        writer->failed = true;
+        return result;
+    }
+    unsigned rank = count ? action_rank(words, action_id) : 0;
+    for (unsigned b = 0; b < bits; b++, writer->bit_pos++)
+    {
+        if (rank >> b & 1)
+            writer->actions.data[writer->bit_pos / 8] |= (uint8_t)(1u << (writer->bit_pos % 8));
+    }
+    writer->actions.size = (size_t)((writer->bit_pos + 7) / 8);
+
+    if (writer->flags & REPLAY_RECORD_OBSERVATIONS)
+    {
+        size_t obs_size = game_observation_size();
+        if (buffer_reserve(&writer->observations, obs_size * sizeof(float)))
+        {
+            game_get_observation(state, state->current_player, writer->obs_mode,
+                                 (float *)(void *)(writer->observations.data + writer->observations.size), obs_size);
+            writer->observations.size += obs_size * sizeof(float);
+        }
+        else
+        {
+            writer->failed = true;
+        }
+    }
+
+    result = game_step_action(state, action_id);
+    writer->num_steps++;
+
+    if ((writer->flags & REPLAY_RECORD_REWARDS) && !buffer_append(&writer->rewards, &result.reward, sizeof(float)))
+        writer->failed = true;
+
+    if (result.round_done && !result.done)
+        game_start_new_round(state);
+    return result;
+}
+
+bool replay_writer_end_game(ReplayWriter *writer)
+{
+    if (!writer || !writer->in_game)
+        return false;
+
+    writer->in_game = false;
+    if (writer->failed)
+        return false;
+
+    if (writer->num_games == writer->index_capacity)
+    {
+        size_t capacity = writer->index_capacity ? writer->index_capacity * 2 : 64;
+        uint64_t *index = realloc(writer->index, capacity * sizeof(uint64_t));
+        if (!index)
+            return false;
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+
+    uint8_t header[REPLAY_RECORD_HEADER_SIZE];
+    size_t action_bytes = pad4(writer->actions.size);
+    put_u64(header, writer->seed);
+    header[8] = writer->num_players;
+    header[9] = (uint8_t)writer->variant;
+    header[10] = (uint8_t)writer->flags;
+    header[11] = (uint8_t)writer->obs_mode;
+    put_u32(header + 12, writer->num_steps);
+    put_u32(header + 16, (uint32_t)action_bytes);
+
+    // padding bytes are already zero: buffers are cleared on reset and growth
+    if (!buffer_reserve(&writer->actions, action_bytes - writer->actions.size))
+        return false;
+
+    bool ok = fwrite(header, sizeof(header), 1, writer->file) == 1;
+    if (ok && action_bytes)
+        ok = fwrite(writer->actions.data, action_bytes, 1, writer->file) == 1;
+    if (ok && writer->rewards.size)
+        ok = fwrite(writer->rewards.data, writer->rewards.size, 1, writer->file) == 1;
+    if (ok && writer->observations.size)
+        ok = fwrite(writer->observations.data, writer->observations.size, 1, writer->file) == 1;
+    if (!ok)
+        return false;
+
+    writer->index[writer->num_games++] = writer->offset;
+    writer->offset += sizeof(header) + action_bytes + writer->rewards.size + writer->observations.size;
+    return true;
+}
+
+bool replay_writer_close(ReplayWriter *writer)
+{
+    if (!writer)
+        return false;
+
+    uint64_t count = writer->num_games;
+    uint64_t index_offset = writer->offset;
+    bool ok = count == 0 || fwrite(writer->index, sizeof(uint64_t), count, writer->file) == count;
+    ok = ok && fwrite(&count, sizeof(count), 1, writer->file) == 1;
+    ok = ok && fwrite(&index_offset, sizeof(index_offset), 1, writer->file) == 1;
+    ok = ok && fwrite(REPLAY_INDEX_MAGIC, REPLAY_MAGIC_LEN, 1, writer->file) == 1;
+    ok = fclose(writer->file) == 0 && ok;
+
+    free(writer->actions.data);
+    free(writer->rewards.data);
+    free(writer->observations.data);
+    free(writer->index);
+    free(writer);
+    return ok;
+}
+
+// size of the record at offset, or 0 if it is malformed or does not fit in limit
+static uint64_t record_size(const ReplayReader *reader, uint64_t offset, uint64_t limit)
+{
+    if (offset + REPLAY_RECORD_HEADER_SIZE > limit)
+        return 0;
+
+    const uint8_t *header = reader->map + offset;
+    uint64_t steps = get_u32(header + 12);
+    uint64_t action_bytes = get_u32(header + 16);
+    if (header[8] < NUM_PLAYERS_MIN || header[8] > NUM_PLAYERS_MAX || header[9] > GAME_VARIANT_DRAW ||
+        header[10] > (REPLAY_RECORD_REWARDS | REPLAY_RECORD_OBSERVATIONS) || header[11] > GAME_OBS_PARTIAL ||
+        action_bytes > pad4(steps))
+        return 0;
+
+    uint64_t size = REPLAY_RECORD_HEADER_SIZE + action_bytes;
+    if (header[10] & REPLAY_RECORD_REWARDS)
+        size += steps * sizeof(float);
+    if (header[10] & REPLAY_RECORD_OBSERVATIONS)
+        size += steps * game_observation_size() * sizeof(float);
+
+    return offset + size <= limit ? size : 0;
+}
+
+// rebuilds the index of a file whose trailer is missing, e.g. after a crash
+static bool reader_scan(ReplayReader *reader)
+{
+    size_t capacity = 0;
+    uint64_t offset = REPLAY_HEADER_SIZE;
+    uint64_t size;
+
+    while ((size = record_size(reader, offset, reader->map_size)) != 0)
+    {
+        if (reader->num_games == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            uint64_t *offsets = realloc(reader->offsets, capacity * sizeof(uint64_t));
+            if (!offsets)
+                return false;
+            reader->offsets = offsets;
+        }
+        reader->offsets[reader->num_games++] = offset;
+        offset += size;
+    }
+    return true;
+}
+
+static bool reader_load_index(ReplayReader *reader)
+{
+    if (reader->map_size < REPLAY_HEADER_SIZE + REPLAY_TRAILER_SIZE)
+        return false;
+
+    const uint8_t *trailer = reader->map + reader->map_size - REPLAY_TRAILER_SIZE;
+    if (memcmp(trailer + 16, REPLAY_INDEX_MAGIC, REPLAY_MAGIC_LEN) != 0)
+        return false;
+
+    uint64_t count = get_u64(trailer);
+    uint64_t index_offset = get_u64(trailer + 8);
+    if (index_offset < REPLAY_HEADER_SIZE || count > (reader->map_size - index_offset) / sizeof(uint64_t) ||
+        index_offset + count * sizeof(uint64_t) + REPLAY_TRAILER_SIZE != reader->map_size)
+        return false;
+
+    reader->offsets = malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!reader->offsets)
+        return false;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t offset = get_u64(reader->map + index_offset + i * sizeof(uint64_t));
+        if (offset < REPLAY_HEADER_SIZE || record_size(reader, offset, index_offset) == 0)
+        {
+            free(reader->offsets);
+            reader->offsets = NULL;
+            return false;
+        }
+        reader->offsets[i] = offset;
+    }
+    reader->num_games = count;
+    return true;
+}
+
+ReplayReader *replay_reader_open(const char *path)
+{
+    if (!path)
+        return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < REPLAY_HEADER_SIZE)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    ReplayReader *reader = calloc(1, sizeof(*reader));
+    if (!reader)
+    {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    reader->map = map;
+    reader->map_size = (size_t)st.st_size;
+
+    if (memcmp(reader->map, REPLAY_MAGIC, REPLAY_MAGIC_LEN) != 0 || get_u32(reader->map + 8) != REPLAY_VERSION ||
+        get_u32(reader->map + 12) != game_observation_size() || (!reader_load_index(reader) && !reader_scan(reader)))
+    {
+        replay_reader_close(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+void replay_reader_close(ReplayReader *reader)
+{
+    if (!reader)
+        return;
+
+    munmap((void *)reader->map, reader->map_size);
+    free(reader->offsets);
+    free(reader);
+}
+
+size_t replay_reader_num_games(const ReplayReader *reader)
+{
+    return reader ? reader->num_games : 0;
+}
+
+bool replay_reader_game_info(const ReplayReader *reader, size_t game, ReplayGameInfo *out)
+{
+    if (!reader || !out || game >= reader->num_games)
+        return false;
+
+    const uint8_t *header = reader->map + reader->offsets[game];
+    out->seed = get_u64(header);
+    out->num_players = header[8];
+    out->variant = (GameVariant)header[9];
+    out->flags = header[10];
+    out->obs_mode = (GameObsMode)header[11];
+    out->num_steps = get_u32(header + 12);
+    return true;
+}
+
+bool replay_cursor_init(ReplayCursor *cursor, const ReplayReader *reader, size_t game, GameState *state)
+{
+    ReplayGameInfo info;
+    if (!cursor || !state || !replay_reader_game_info(reader, game, &info))
+        return false;
+    if (!game_init_into(state, info.num_players, info.variant, info.seed))
+        return false;
+
+    const uint8_t *record = reader->map + reader->offsets[game];
+    const uint8_t *payload = record + REPLAY_RECORD_HEADER_SIZE + get_u32(record + 16);
+
+    cursor->reader = reader;
+    cursor->state = state;
+    cursor->actions = record + REPLAY_RECORD_HEADER_SIZE;
+    cursor->rewards = NULL;
+    cursor->observations = NULL;
+    if (info.flags & REPLAY_RECORD_REWARDS)
+    {
+        cursor->rewards = (const float *)(const void *)payload;
+        payload += (size_t)info.num_steps * sizeof(float);
+    }
+    if (info.flags & REPLAY_RECORD_OBSERVATIONS)
+        cursor->observations = (const float *)(const void *)payload;
+    cursor->bit_pos = 0;
+    cursor->action_bytes = get_u32(record + 16);
+    cursor->step = 0;
+    cursor->num_steps = info.num_steps;
+    cursor->obs_mode = info.obs_mode;
+    return true;
+}
+
+bool replay_cursor_next(ReplayCursor *cursor, ReplayStep *out, float *obs, size_t obs_len, uint8_t *mask,
+                        size_t mask_len)
+{
+    if (!cursor || !cursor->state || cursor->step >= cursor->num_steps || cursor->state->game_over)
+        return false;
+
+    GameState *state = cursor->state;
+    uint64_t words[LEGAL_ACTION_WORDS];
+    replay_legal_words(state, words);
+    unsigned count = legal_count(words);
+    unsigned bits = rank_bits(count);
+    if (cursor->bit_pos + bits > 8 * (uint64_t)cursor->action_bytes)
+        return false;
+
+    uint8_t player = state->current_player;
+    if (obs)
+        game_get_observation(state, player, cursor->obs_mode, obs, obs_len);
+    if (mask)
+        game_get_legal_action_mask(state, mask, mask_len);
+
+    unsigned rank = 0;
+    for (unsigned b = 0; b < bits; b++, cursor->bit_pos++)
+        rank |= (unsigned)(cursor->actions[cursor->bit_pos / 8] >> (cursor->bit_pos % 8) & 1) << b;
+
+    uint16_t action_id = count ? action_from_rank(words, rank) : 0;
+    StepResult result = game_step_action(state, action_id);
+    if (result.round_done && !result.done)
+        game_start_new_round(state);
+
+    if (out)
+    {
+        out->action_id = action_id;
+        out->player = player;
+        out->reward = cursor->rewards ? cursor->rewards[cursor->step] : result.reward;
+        out->round_done = result.round_done;
+        out->done = result.done;
+        out->stored_obs =
+            cursor->observations ? cursor->observations + (size_t)cursor->step * game_observation_size() : NULL;
+    }
+
+    cursor->step++;
+    return true;
+}
@@ -0,0 +1,344 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "poison_solver.h"
+#include "poison_internal.h"
+
+#include <limits.h>
+#include <time.h>
+
+#define SOLVER_NO_MOVE 0xFF
+#define SOLVER_DEFAULT_TT_ENTRIES (1u << 18)
+
+#define SOLVER_BOUND_EXACT 0
+#define SOLVER_BOUND_LOWER 1
+#define SOLVER_BOUND_UPPER 2
+
+typedef struct
+{
+    GameState *state;
+    TranspositionTable *tt;
+    uint64_t salt;
+    uint8_t root_player;
+    uint64_t nodes;
+    uint64_t tt_hits;
+} Solver;
+
+static double solver_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+void solver_config_default(SolverConfig *config)
+{
+    if (!config)
+        return;
+
+    config->mode = SOLVER_MAXN;
+    config->max_hand_cards = 12;
+    config->tt = NULL;
+}
+
+// keeps max-n and paranoid entries (which depend on the root seat) apart in a shared table
+static uint64_t solver_salt(SolverMode mode, uint8_t root_player)
+{
+    uint64_t x = 0x5D1E5A17C0FFEE00ull + (uint64_t)mode * NUM_PLAYERS_MAX + root_player;
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+// TT payload: bytes 0-5 values, byte 6 best typed move + 1, byte 7 marker | bound
+static uint64_t solver_pack(const int8_t *values, uint8_t count, uint8_t move, uint8_t bound)
+{
+    uint64_t data = 0;
+    for (uint8_t i = 0; i < count; i++)
+        data |= (uint64_t)(uint8_t)values[i] << (8 * i);
+    data |= (uint64_t)(uint8_t)(move + 1) << 48;
+    data |= (uint64_t)(0x80u | bound) << 56;
+    return data;
+}
+
+static void solver_unpack(uint64_t data, int8_t *values, uint8_t count, uint8_t *move, uint8_t *bound)
+{
+    for (uint8_t i = 0; i < count; i++)
+        values[i] = (int8_t)(uint8_t)(data >> (8 * i));
+    *move = (uint8_t)((data >> 48) & 0xFF) - 1;
+    *bound = (uint8_t)((data >> 56) & 0x7F);
+}
+
+// cards the mover would pick up by playing this move; 0 unless it overflows
+static int solver_move_cost(const GameState *state, uint8_t typed_action)
+{
+    const Cauldron *cauldron = &state->cauldrons[typed_action % NUM_CAULDRONS];
+    uint8_t type = (uint8_t)(typed_action / NUM_CAULDRONS);
+
+    if (cauldron->total_value + CARD_TYPES[type].value <= CAULDRON_THRESHOLD)
+        return 0;
+    return 2 * cauldron->counts[POISON_TYPE_INDEX] + cauldron->num_cards;
+}
+
+// distinct (card type, cauldron) moves, TT move first, then cheapest for the mover
+static uint8_t solver_moves(const GameState *state, uint8_t tt_move, uint8_t *out_moves)
+{
+    uint64_t typed;
+    game_get_typed_legal_action_bits(state, &typed);
+
+    uint8_t count = 0;
+    int costs[TYPED_ACTIONS];
+    if (tt_move != SOLVER_NO_MOVE && (typed >> tt_move & 1))
+    {
+        out_moves[count++] = tt_move;
+        typed &= ~(1ull << tt_move);
+    }
+
+    uint8_t sorted_from = count;
+    for (; typed; typed &= typed - 1)
+    {
+        uint8_t move = (uint8_t)__builtin_ctzll(typed);
+        int cost = solver_move_cost(state, move);
+        uint8_t i = count++;
+        while (i > sorted_from && costs[i - 1] > cost)
+        {
+            out_moves[i] = out_moves[i - 1];
+            costs[i] = costs[i - 1];
+            i--;
+        }
+        out_moves[i] = move;
+        costs[i] = cost;
+    }
+    return count;
+}
+
+static void solver_leaf(GameState *state, int8_t *values)
+{
+    int32_t scores[NUM_PLAYERS_MAX] = {0};
+    game_apply_round_scores(state, scores);
+    for (uint8_t i = 0; i < state->num_players; i++)
+        values[i] = (int8_t)scores[i];
+}
+
+// max-n: the mover keeps the child best for itself; ties go to the child worst
+// for everyone else, then to the lowest typed move, so the result does not
+// depend on move ordering
+static void solver_maxn(Solver *solver, int8_t *values, uint8_t *out_move)
+{
+    GameState *state = solver->state;
+    uint8_t num_players = state->num_players;
+    GameUndo undo;
+
+    solver->nodes++;
+    if (state->round_scored)
+    {
+        solver_leaf(state, values);
+        return;
+    }
+
+    uint8_t mover = state->current_player;
+    if (state->players[mover].hand_size == 0)
+    {
+        game_step_with_undo(state, 0, &undo);
+        solver_maxn(solver, values, NULL);
+        game_undo(state, &undo);
+        return;
+    }
+
+    uint64_t key = state->hash ^ solver->salt;
+    uint64_t data;
+    uint8_t tt_move = SOLVER_NO_MOVE;
+    if (tt_probe(solver->tt, key, &data) && (data >> 63))
+    {
+        uint8_t bound;
+        solver->tt_hits++;
+        solver_unpack(data, values, num_players, &tt_move, &bound);
+        if (!out_move)
+            return;
+    }
+
+    uint8_t moves[TYPED_ACTIONS];
+    uint8_t num_moves = solver_moves(state, tt_move, moves);
+    uint8_t best_move = SOLVER_NO_MOVE;
+    int best_others = 0;
+
+    for (uint8_t m = 0; m < num_moves; m++)
+    {
+        int8_t child[NUM_PLAYERS_MAX];
+        game_step_with_undo(state, game_typed_to_action(state, moves[m]), &undo);
+        solver_maxn(solver, child, NULL);
+        game_undo(state, &undo);
+
+        int others = 0;
+        for (uint8_t i = 0; i < num_players; i++)
+            others += i == mover ? 0 : child[i];
+
+        bool better = child[mover] > values[mover] ||
+                      (child[mover] == values[mover] &&
+                       (others < best_others || (others == best_others && moves[m] < best_move)));
+        if (best_move == SOLVER_NO_MOVE || better)
+        {
+            best_move = moves[m];
+            best_others = others;
+            for (uint8_t i = 0; i < num_players; i++)
+                values[i] = child[i];
+        }
+    }
+
+    tt_store(solver->tt, key, solver_pack(values, num_players, best_move, SOLVER_BOUND_EXACT));
+    if (out_move)
+        *out_move = best_move;
+}
+
+// paranoid: the root seat maximises its round score, all other seats minimise it
+static int32_t solver_paranoid(Solver *solver, int32_t alpha, int32_t beta, uint8_t *out_move)
+{
+    GameState *state = solver->state;
+    GameUndo undo;
+
+    solver->nodes++;
+    if (state->round_scored)
+    {
+        int8_t values[NUM_PLAYERS_MAX];
+        solver_leaf(state, values);
+        return values[solver->root_player];
+    }
+
+    uint8_t mover = state->current_player;
+    if (state->players[mover].hand_size == 0)
+    {
+        game_step_with_undo(state, 0, &undo);
+        int32_t value = solver_paranoid(solver, alpha, beta, NULL);
+        game_undo(state, &undo);
+        return value;
+    }
+
+    uint64_t key = state->hash ^ solver->salt;
+    uint64_t data;
+    uint8_t tt_move = SOLVER_NO_MOVE;
+    if (tt_probe(solver->tt, key, &data) && (data >> 63))
+    {
+        int8_t stored;
+        uint8_t bound;
+        solver->tt_hits++;
+        solver_unpack(data, &stored, 1, &tt_move, &bound);
+        if (!out_move)
+        {
+            if (bound == SOLVER_BOUND_EXACT)
+                return stored;
+            if (bound == SOLVER_BOUND_LOWER && stored > alpha)
+                alpha = stored;
+            if (bound == SOLVER_BOUND_UPPER && stored < beta)
+                beta = stored;
+            if (alpha >= beta)
+                return stored;
+        }
+    }
+
+    int32_t alpha_orig = alpha;
+    int32_t beta_orig = beta;
+    bool maximizing = mover == solver->root_player;
+    int32_t best = maximizing ? INT32_MIN : INT32_MAX;
+    uint8_t best_move = SOLVER_NO_MOVE;
+
+    uint8_t moves[TYPED_ACTIONS];
+    uint8_t num_moves = solver_moves(state, tt_move, moves);
+    for (uint8_t m = 0; m < num_moves; m++)
+    {
+        game_step_with_undo(state, game_typed_to_action(state, moves[m]), &undo);
+        int32_t value = solver_paranoid(solver, alpha, beta, NULL);
+        game_undo(state, &undo);
+
+        if (maximizing ? value > best : value < best)
+        {
+            best = value;
+            best_move = moves[m];
+        }
+        if (maximizing && best > alpha)
+            alpha = best;
+        if (!maximizing && best < beta)
+            beta = best;
+        if (alpha >= beta)
+            break;
+    }
+
+    uint8_t bound = SOLVER_BOUND_EXACT;
+    if (best <= alpha_orig)
+        bound = SOLVER_BOUND_UPPER;
+    else if (best >= beta_orig)
+        bound = SOLVER_BOUND_LOWER;
+
+    int8_t stored = (int8_t)best;
+    tt_store(solver->tt, key, solver_pack(&stored, 1, best_move, bound));
+    if (out_move)
+        *out_move = best_move;
+    return best;
+}
+
+bool solver_solve(const GameState *state, const SolverConfig *config, uint16_t *out_action,
+                  int32_t *out_round_scores, SolverStats *stats)
+{
+    if (!state || !config || state->variant != GAME_VARIANT_CLASSIC)
+        return false;
+    if (state->game_over || state->round_scored)
+        return false;
+    if (state->cards_in_hands > config->max_hand_cards)
+        return false;
+    if (state->players[state->current_player].hand_size == 0)
+        return false;
+
+    TranspositionTable *tt = config->tt;
+    TranspositionTable *own_tt = NULL;
+    if (!tt)
+    {
+        own_tt = tt_create(SOLVER_DEFAULT_TT_ENTRIES);
+        if (!own_tt)
+            return false;
+        tt = own_tt;
+    }
+
+    GameState *scratch = game_clone(state);
+    if (!scratch)
+    {
+        tt_destroy(own_tt);
+        return false;
+    }
+
+    Solver solver = {0};
+    solver.state = scratch;
+    solver.tt = tt;
+    solver.root_player = state->current_player;
+    solver.salt = solver_salt(config->mode, config->mode == SOLVER_PARANOID ? solver.root_player : 0);
+
+    double start_ms = solver_now_ms();
+    uint8_t best_move = SOLVER_NO_MOVE;
+    int8_t values[NUM_PLAYERS_MAX] = {0};
+
+    if (config->mode == SOLVER_PARANOID)
+        values[solver.root_player] = (int8_t)solver_paranoid(&solver, INT32_MIN, INT32_MAX, &best_move);
+    else
+        solver_maxn(&solver, values, &best_move);
+
+    double elapsed_ms = solver_now_ms() - start_ms;
+
+    if (out_action)
+        *out_action = game_typed_to_action(state, best_move);
+    if (out_round_scores)
+    {
+        for (uint8_t i = 0; i < state->num_players; i++)
+            out_round_scores[i] = values[i];
+    }
+    if (stats)
+    {
+        stats->nodes = solver.nodes;
+        stats->tt_hits = solver.tt_hits;
+        stats->elapsed_ms = elapsed_ms;
+        stats->nodes_per_sec = elapsed_ms > 0.0 ? (double)solver.nodes * 1000.0 / elapsed_ms : 0.0;
+    }
+
+    game_destroy(scratch);
+    tt_destroy(own_tt);
+    return true;
+}
@@ -0,0 +1,742 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "poison_tournament.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TOURNAMENT_MAX_THREADS 256
+#define TOURNAMENT_MAX_SEATINGS (2 * NUM_PLAYERS_MAX)
+#define TOURNAMENT_PRIOR_SD 4.0 // Bradley-Terry prior in logistic units, keeps perfect records finite
+#define TOURNAMENT_NEWTON_ITERATIONS 64
+
+typedef struct
+{
+    uint32_t a;
+    uint32_t b;
+} TournamentPair;
+
+// one duplicate set: a deal replayed under every seating of a pairing
+typedef struct
+{
+    uint32_t games;
+    uint32_t wins_a;
+    uint32_t wins_b;
+    uint32_t draws;
+    uint64_t steps;
+    double score_diff_sum;
+    int64_t score_a;
+    int64_t score_b;
+    uint32_t seats_a;
+    uint32_t seats_b;
+} TournamentSet;
+
+typedef struct
+{
+    GameState *state;
+    uint32_t set;       // index into the round's results
+    uint8_t b_seats;    // bit s set = seat s belongs to the pairing's b
+    uint32_t entrants[NUM_PLAYERS_MAX];
+} TournamentGame;
+
+typedef struct
+{
+    const TournamentConfig *config;
+    const TournamentEntrant *entrants;
+    size_t num_entrants;
+    const TournamentPair *pairs;
+    size_t num_pairs;
+    uint8_t counts[NUM_PLAYERS_MAX];
+    uint8_t num_counts;
+
+    // current round: sets [round_first, round_end), results indexed from round_first
+    TournamentSet *results;
+    uint64_t round_first;
+    uint64_t round_end;
+    _Atomic uint64_t next_batch;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    uint64_t generation;
+    uint32_t busy;
+    bool quit;
+} TournamentRunner;
+
+typedef struct
+{
+    TournamentRunner *runner;
+    pthread_t thread;
+    bool ok;
+    GamePool *arena;
+    TournamentGame *games;
+    const GameState **batch_states;
+    uint32_t *batch_games;
+    uint16_t *actions;
+    uint32_t *bucket_counts;
+} TournamentWorker;
+
+static double tournament_now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void tournament_config_default(TournamentConfig *config)
+{
+    if (!config)
+        return;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    config->mode = TOURNAMENT_ROUND_ROBIN;
+    config->player_counts = 0;
+    for (uint8_t n = NUM_PLAYERS_MIN; n <= NUM_PLAYERS_MAX; n++)
+        config->player_counts |= (uint8_t)(1u << n);
+    config->variant = GAME_VARIANT_CLASSIC;
+    config->max_deals = 1000;
+    config->min_deals = 20;
+    config->check_interval = 20;
+    config->num_threads = cpus > 0 ? (uint32_t)cpus : 1;
+    config->batch_sets = 16;
+    config->seed = 0x7E57AB1Eu;
+    config->z = 1.96;
+    config->stop_when_significant = true;
+}
+
+size_t tournament_num_pairings(TournamentMode mode, size_t num_entrants)
+{
+    if (num_entrants < 2)
+        return 0;
+    return mode == TOURNAMENT_GAUNTLET ? num_entrants - 1 : num_entrants * (num_entrants - 1) / 2;
+}
+
+// distinct seatings of a pairing at a table of n, as masks of b's seats:
+// rotations of a, b, a, b, ... and of its mirror
+static uint8_t tournament_seatings(uint8_t n, uint8_t *out_masks)
+{
+    uint8_t full = (uint8_t)((1u << n) - 1);
+    uint8_t base = 0;
+    for (uint8_t s = 1; s < n; s += 2)
+        base |= (uint8_t)(1u << s);
+
+    uint8_t count = 0;
+    for (uint8_t mirror = 0; mirror < 2; mirror++)
+    {
+        uint8_t pattern = mirror ? (uint8_t)(~base & full) : base;
+        for (uint8_t r = 0; r < n; r++)
+        {
+            uint8_t mask = (uint8_t)(((pattern >> r) | (pattern << (n - r))) & full);
+            bool seen = false;
+            for (uint8_t i = 0; i < count && !seen; i++)
+                seen = out_masks[i] == mask;
+            if (!seen)
+                out_masks[count++] = mask;
+        }
+    }
+    return count;
+}
+
+static void tournament_act(const TournamentEntrant *entrant, const GameState *const *states, size_t count,
+                           GameRng *rng, uint16_t *out_actions)
+{
+    if (entrant->act)
+        entrant->act(entrant->ctx, states, count, rng, out_actions);
+    else
+        policy_act_batch(entrant->policy, states, count, rng, out_actions);
+}
+
+static void tournament_finish_game(const TournamentGame *game, TournamentSet *set)
+{
+    uint8_t n = game_get_num_players(game->state);
+    int64_t sum_a = 0, sum_b = 0;
+    uint32_t seats_a = 0, seats_b = 0;
+
+    for (uint8_t s = 0; s < n; s++)
+    {
+        int32_t score = game_get_player_score(game->state, s);
+        if (game->b_seats & (1u << s))
+        {
+            sum_b += score;
+            seats_b++;
+        }
+        else
+        {
+            sum_a += score;
+            seats_a++;
+        }
+    }
+
+    double diff = (double)sum_a / seats_a - (double)sum_b / seats_b;
+    set->games++;
+    set->wins_a += diff > 0.0;
+    set->wins_b += diff < 0.0;
+    set->draws += diff == 0.0;
+    set->score_diff_sum += diff;
+    set->score_a += sum_a;
+    set->score_b += sum_b;
+    set->seats_a += seats_a;
+    set->seats_b += seats_b;
+}
+
+// plays duplicate sets [first, end) in lockstep: every turn, the states waiting
+// on each entrant go to it in one batched call
+static void tournament_play_batch(TournamentWorker *worker, uint64_t first, uint64_t end)
+{
+    TournamentRunner *runner = worker->runner;
+    const TournamentConfig *config = runner->config;
+    uint64_t sets_per_deal = (uint64_t)runner->num_pairs * runner->num_counts;
+    uint32_t live = 0;
+
+    for (uint64_t id = first; id < end; id++)
+    {
+        uint64_t deal = id / sets_per_deal;
+        const TournamentPair *pair = &runner->pairs[id % sets_per_deal / runner->num_counts];
+        uint8_t n = runner->counts[id % runner->num_counts];
+        uint64_t seed = game_seed_for(config->seed, n, deal);
+        uint32_t set = (uint32_t)(id - runner->round_first);
+        uint8_t masks[TOURNAMENT_MAX_SEATINGS];
+        uint8_t seatings = tournament_seatings(n, masks);
+
+        memset(&runner->results[set], 0, sizeof(runner->results[set]));
+        for (uint8_t k = 0; k < seatings; k++)
+        {
+            TournamentGame *game = &worker->games[live++];
+            game_init_into(game->state, n, config->variant, seed);
+            game->set = set;
+            game->b_seats = masks[k];
+            for (uint8_t s = 0; s < n; s++)
+                game->entrants[s] = (masks[k] & (1u << s)) ? pair->b : pair->a;
+        }
+    }
+
+    // tie-breaks depend only on which sets are played, not on the thread
+    GameRng rng;
+    game_rng_seed(&rng, config->seed, first + 1);
+
+    while (live)
+    {
+        memset(worker->bucket_counts, 0, (runner->num_entrants + 1) * sizeof(uint32_t));
+        for (uint32_t g = 0; g < live; g++)
+        {
+            const TournamentGame *game = &worker->games[g];
+            worker->bucket_counts[game->entrants[game_get_current_player(game->state)] + 1]++;
+        }
+        for (size_t e = 0; e < runner->num_entrants; e++)
+            worker->bucket_counts[e + 1] += worker->bucket_counts[e];
+        for (uint32_t g = 0; g < live; g++)
+        {
+            const TournamentGame *game = &worker->games[g];
+            uint32_t slot = worker->bucket_counts[game->entrants[game_get_current_player(game->state)]]++;
+            worker->batch_states[slot] = game->state;
+            worker->batch_games[slot] = g;
+        }
+
+        // bucket_counts[e] now ends entrant e's run
+        uint32_t begin = 0;
+        for (size_t e = 0; e < runner->num_entrants; e++)
+        {
+            uint32_t stop = worker->bucket_counts[e];
+            if (stop > begin)
+                tournament_act(&runner->entrants[e], &worker->batch_states[begin], stop - begin, &rng,
+                               &worker->actions[begin]);
+            begin = stop;
+        }
+
+        for (uint32_t i = 0; i < live; i++)
+        {
+            TournamentGame *game = &worker->games[worker->batch_games[i]];
+            StepResult step = game_step_action(game->state, worker->actions[i]);
+            runner->results[game->set].steps++;
+            if (step.round_done && !step.done)
+                game_start_new_round(game->state);
+        }
+
+        // retire finished games by swapping in the last live one
+        for (uint32_t g = 0; g < live;)
+        {
+            TournamentGame *game = &worker->games[g];
+            if (!game_is_game_over(game->state))
+            {
+                g++;
+                continue;
+            }
+
+            tournament_finish_game(game, &runner->results[game->set]);
+            TournamentGame done = *game;
+            *game = worker->games[--live];
+            worker->games[live] = done;
+        }
+    }
+}
+
+static bool tournament_worker_setup(TournamentWorker *worker)
+{
+    const TournamentRunner *runner = worker->runner;
+    size_t capacity = (size_t)runner->config->batch_sets * TOURNAMENT_MAX_SEATINGS;
+
+    worker->arena = game_pool_create(capacity);
+    worker->games = malloc(capacity * sizeof(*worker->games));
+    worker->batch_states = malloc(capacity * sizeof(*worker->batch_states));
+    worker->batch_games = malloc(capacity * sizeof(*worker->batch_games));
+    worker->actions = malloc(capacity * sizeof(*worker->actions));
+    worker->bucket_counts = malloc((runner->num_entrants + 1) * sizeof(*worker->bucket_counts));
+    if (!worker->arena || !worker->games || !worker->batch_states || !worker->batch_games || !worker->actions ||
+        !worker->bucket_counts)
+        return false;
+
+    for (size_t i = 0; i < capacity; i++)
+        worker->games[i].state = game_pool_acquire(worker->arena);
+    return true;
+}
+
+static void tournament_worker_teardown(TournamentWorker *worker)
+{
+    free(worker->bucket_counts);
+    free(worker->actions);
+    free(worker->batch_games);
+    free(worker->batch_states);
+    free(worker->games);
+    game_pool_destroy(worker->arena);
+}
+
+static void *tournament_worker_main(void *arg)
+{
+    TournamentWorker *worker = arg;
+    TournamentRunner *runner = worker->runner;
+    uint64_t batch_sets = runner->config->batch_sets;
+    uint64_t seen = 0;
+
+    // the arena is allocated here so its pages are first touched by this thread
+    worker->ok = tournament_worker_setup(worker);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&runner->lock);
+        while (!runner->quit && runner->generation == seen)
+            pthread_cond_wait(&runner->start_cond, &runner->lock);
+        if (runner->quit)
+        {
+            pthread_mutex_unlock(&runner->lock);
+            break;
+        }
+        seen = runner->generation;
+        pthread_mutex_unlock(&runner->lock);
+
+        // a worker whose setup failed leaves its share to the others
+        for (;;)
+        {
+            if (!worker->ok)
+                break;
+            uint64_t first = runner->round_first + atomic_fetch_add(&runner->next_batch, 1) * batch_sets;
+            if (first >= runner->round_end)
+                break;
+            uint64_t end = first + batch_sets < runner->round_end ? first + batch_sets : runner->round_end;
+            tournament_play_batch(worker, first, end);
+        }
+
+        pthread_mutex_lock(&runner->lock);
+        if (--runner->busy == 0)
+            pthread_cond_signal(&runner->done_cond);
+        pthread_mutex_unlock(&runner->lock);
+    }
+
+    tournament_worker_teardown(worker);
+    return NULL;
+}
+
+static void tournament_run_round(TournamentRunner *runner, uint32_t num_threads, uint64_t first, uint64_t end)
+{
+    pthread_mutex_lock(&runner->lock);
+    runner->round_first = first;
+    runner->round_end = end;
+    atomic_store(&runner->next_batch, 0);
+    runner->busy = num_threads;
+    runner->generation++;
+    pthread_cond_broadcast(&runner->start_cond);
+    while (runner->busy)
+        pthread_cond_wait(&runner->done_cond, &runner->lock);
+    pthread_mutex_unlock(&runner->lock);
+}
+
+// in-place Gauss-Jordan inverse of an n x n matrix
+static bool tournament_invert(double *m, size_t n, double *scratch)
+{
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            scratch[i * n + j] = i == j;
+
+    for (size_t col = 0; col < n; col++)
+    {
+        size_t pivot = col;
+        for (size_t r = col + 1; r < n; r++)
+        {
+            if (fabs(m[r * n + col]) > fabs(m[pivot * n + col]))
+                pivot = r;
+        }
+        if (fabs(m[pivot * n + col]) < 1e-300)
+            return false;
+
+        for (size_t j = 0; j < n; j++)
+        {
+            double t = m[col * n + j];
+            m[col * n + j] = m[pivot * n + j];
+            m[pivot * n + j] = t;
+            t = scratch[col * n + j];
+            scratch[col * n + j] = scratch[pivot * n + j];
+            scratch[pivot * n + j] = t;
+        }
+
+        double inv = 1.0 / m[col * n + col];
+        for (size_t j = 0; j < n; j++)
+        {
+            m[col * n + j] *= inv;
+            scratch[col * n + j] *= inv;
+        }
+        for (size_t r = 0; r < n; r++)
+        {
+            double f = m[r * n + col];
+            if (r == col || f == 0.0)
+                continue;
+            for (size_t j = 0; j < n; j++)
+            {
+                m[r * n + j] -= f * m[col * n + j];
+                scratch[r * n + j] -= f * scratch[col * n + j];
+            }
+        }
+    }
+
+    memcpy(m, scratch, n * n * sizeof(double));
+    return true;
+}
+
+// Newton iterations on the Bradley-Terry log-likelihood plus a Gaussian prior;
+// wins[i * n + j] counts i beating j. Leaves the ratings in out_beta and the
+// covariance (inverse negative Hessian) in out_cov.
+static bool tournament_fit(const double *wins, size_t n, double *out_beta, double *out_cov)
+{
+    double *grad = calloc(n, sizeof(double));
+    double *scratch = malloc(n * n * sizeof(double));
+    bool ok = grad && scratch;
+    double prior = 1.0 / (TOURNAMENT_PRIOR_SD * TOURNAMENT_PRIOR_SD);
+
+    memset(out_beta, 0, n * sizeof(double));
+    for (int iter = 0; ok && iter < TOURNAMENT_NEWTON_ITERATIONS; iter++)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            grad[i] = -prior * out_beta[i];
+            for (size_t j = 0; j < n; j++)
+                out_cov[i * n + j] = i == j ? prior : 0.0;
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t j = i + 1; j < n; j++)
+            {
+                double games = wins[i * n + j] + wins[j * n + i];
+                if (games == 0.0)
+                    continue;
+                double p = 1.0 / (1.0 + exp(out_beta[j] - out_beta[i]));
+                double g = wins[i * n + j] - games * p;
+                double w = games * p * (1.0 - p);
+                grad[i] += g;
+                grad[j] -= g;
+                out_cov[i * n + i] += w;
+                out_cov[j * n + j] += w;
+                out_cov[i * n + j] -= w;
+                out_cov[j * n + i] -= w;
+            }
+        }
+
+        ok = tournament_invert(out_cov, n, scratch);
+        double largest = 0.0;
+        for (size_t i = 0; ok && i < n; i++)
+        {
+            double step = 0.0;
+            for (size_t j = 0; j < n; j++)
+                step += out_cov[i * n + j] * grad[j];
+            out_beta[i] += step;
+            largest = fmax(largest, fabs(step));
+        }
+        // the covariance of the last iteration is taken at the converged ratings
+        if (largest < 1e-9)
+            break;
+    }
+
+    free(scratch);
+    free(grad);
+    return ok;
+}
+
+typedef struct
+{
+    uint64_t games;
+    uint64_t wins_a;
+    uint64_t wins_b;
+    uint64_t draws;
+    uint64_t sets;
+    double diff_sum;
+    double diff_sq_sum;
+} TournamentPairTotals;
+
+typedef struct
+{
+    int64_t score;
+    uint64_t seats;
+    uint64_t games;
+} TournamentEntrantTotals;
+
+static double tournament_diff_ci(const TournamentPairTotals *totals, double z, double *out_mean)
+{
+    double sets = (double)totals->sets;
+    double mean = sets > 0.0 ? totals->diff_sum / sets : 0.0;
+    *out_mean = mean;
+    if (totals->sets < 2)
+        return INFINITY;
+    double var = fmax(0.0, (totals->diff_sq_sum - sets * mean * mean) / (sets - 1.0));
+    return z * sqrt(var / sets);
+}
+
+static bool tournament_all_significant(const TournamentPairTotals *totals, size_t count, double z)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        double mean;
+        double ci = tournament_diff_ci(&totals[i], z, &mean);
+        if (!(fabs(mean) > ci))
+            return false;
+    }
+    return true;
+}
+
+static void tournament_report(const TournamentRunner *runner, const TournamentPairTotals *pair_totals,
+                              const TournamentEntrantTotals *entrant_totals, TournamentRating *out_ratings,
+                              TournamentPairing *out_pairings)
+{
+    size_t n = runner->num_entrants;
+    double z = runner->config->z;
+    double elo_per_unit = 400.0 / log(10.0);
+    double *wins = calloc(n * n, sizeof(double));
+    double *beta = calloc(n, sizeof(double));
+    double *cov = calloc(n * n, sizeof(double));
+    bool fitted = false;
+
+    if (wins && beta && cov)
+    {
+        for (size_t p = 0; p < runner->num_pairs; p++)
+        {
+            const TournamentPair *pair = &runner->pairs[p];
+            const TournamentPairTotals *totals = &pair_totals[p];
+            wins[pair->a * n + pair->b] += (double)totals->wins_a + 0.5 * (double)totals->draws;
+            wins[pair->b * n + pair->a] += (double)totals->wins_b + 0.5 * (double)totals->draws;
+        }
+        fitted = tournament_fit(wins, n, beta, cov);
+    }
+
+    double mean_beta = 0.0;
+    for (size_t i = 0; fitted && i < n; i++)
+        mean_beta += beta[i] / (double)n;
+
+    for (size_t i = 0; out_ratings && i < n; i++)
+    {
+        TournamentRating *rating = &out_ratings[i];
+        memset(rating, 0, sizeof(*rating));
+        rating->games = entrant_totals[i].games;
+        rating->mean_score =
+            entrant_totals[i].seats ? (double)entrant_totals[i].score / (double)entrant_totals[i].seats : 0.0;
+        if (!fitted)
+            continue;
+
+        // variance of beta_i minus the field mean
+        double var = 0.0;
+        for (size_t j = 0; j < n; j++)
+        {
+            for (size_t k = 0; k < n; k++)
+            {
+                double vj = (j == i) - 1.0 / (double)n;
+                double vk = (k == i) - 1.0 / (double)n;
+                var += vj * cov[j * n + k] * vk;
+            }
+        }
+        rating->elo = (beta[i] - mean_beta) * elo_per_unit;
+        rating->elo_ci = z * sqrt(fmax(0.0, var)) * elo_per_unit;
+    }
+
+    for (size_t p = 0; out_pairings && p < runner->num_pairs; p++)
+    {
+        const TournamentPair *pair = &runner->pairs[p];
+        const TournamentPairTotals *totals = &pair_totals[p];
+        TournamentPairing *out = &out_pairings[p];
+        memset(out, 0, sizeof(*out));
+        out->a = pair->a;
+        out->b = pair->b;
+        out->games = totals->games;
+        out->wins_a = totals->wins_a;
+        out->wins_b = totals->wins_b;
+        out->draws = totals->draws;
+        out->sets = totals->sets;
+        out->score_diff_ci = tournament_diff_ci(totals, z, &out->score_diff);
+        out->significant = fabs(out->score_diff) > out->score_diff_ci;
+        if (fitted)
+        {
+            double var = cov[pair->a * n + pair->a] + cov[pair->b * n + pair->b] - 2.0 * cov[pair->a * n + pair->b];
+            out->elo_diff = (beta[pair->a] - beta[pair->b]) * elo_per_unit;
+            out->elo_diff_ci = z * sqrt(fmax(0.0, var)) * elo_per_unit;
+        }
+    }
+
+    free(cov);
+    free(beta);
+    free(wins);
+}
+
+bool tournament_run(const TournamentConfig *config, const TournamentEntrant *entrants, size_t num_entrants,
+                    TournamentRating *out_ratings, TournamentPairing *out_pairings, TournamentStats *stats)
+{
+    if (!config || !entrants || num_entrants < 2 || num_entrants > UINT32_MAX)
+        return false;
+    if (config->num_threads == 0 || config->num_threads > TOURNAMENT_MAX_THREADS || config->batch_sets == 0)
+        return false;
+    if (config->max_deals == 0 || config->check_interval == 0)
+        return false;
+
+    TournamentRunner runner = {0};
+    runner.config = config;
+    runner.entrants = entrants;
+    runner.num_entrants = num_entrants;
+    for (uint8_t n = NUM_PLAYERS_MIN; n <= NUM_PLAYERS_MAX; n++)
+    {
+        if (config->player_counts & (1u << n))
+            runner.counts[runner.num_counts++] = n;
+    }
+    if (runner.num_counts == 0)
+        return false;
+
+    size_t num_pairs = tournament_num_pairings(config->mode, num_entrants);
+    TournamentPair *pairs = malloc(num_pairs * sizeof(*pairs));
+    TournamentPairTotals *pair_totals = calloc(num_pairs, sizeof(*pair_totals));
+    TournamentEntrantTotals *entrant_totals = calloc(num_entrants, sizeof(*entrant_totals));
+    TournamentWorker *workers = calloc(config->num_threads, sizeof(*workers));
+    uint64_t sets_per_deal = (uint64_t)num_pairs * runner.num_counts;
+    uint32_t round_deals = config->min_deals > config->check_interval ? config->min_deals : config->check_interval;
+    if (round_deals > config->max_deals)
+        round_deals = config->max_deals;
+    runner.results = malloc(round_deals * sets_per_deal * sizeof(*runner.results));
+
+    bool ok = pairs && pair_totals && entrant_totals && workers && runner.results;
+    size_t p = 0;
+    for (uint32_t a = 0; ok && a < num_entrants; a++)
+    {
+        for (uint32_t b = a + 1; b < num_entrants && (config->mode != TOURNAMENT_GAUNTLET || a == 0); b++)
+            pairs[p++] = (TournamentPair){a, b};
+    }
+    runner.pairs = pairs;
+    runner.num_pairs = num_pairs;
+
+    pthread_mutex_init(&runner.lock, NULL);
+    pthread_cond_init(&runner.start_cond, NULL);
+    pthread_cond_init(&runner.done_cond, NULL);
+
+    uint32_t num_threads = 0;
+    for (uint32_t t = 0; ok && t < config->num_threads; t++)
+    {
+        workers[t].runner = &runner;
+        if (pthread_create(&workers[t].thread, NULL, tournament_worker_main, &workers[t]) != 0)
+            break;
+        num_threads++;
+    }
+    ok = ok && num_threads > 0;
+
+    TournamentStats local = {0};
+    local.significant_after_s = -1.0;
+    double start = tournament_now_s();
+    uint32_t deals = 0;
+
+    while (ok && deals < config->max_deals)
+    {
+        uint32_t count = deals == 0 ? round_deals : config->check_interval;
+        if (count > config->max_deals - deals)
+            count = config->max_deals - deals;
+
+        uint64_t first = deals * sets_per_deal;
+        uint64_t end = (deals + count) * sets_per_deal;
+        tournament_run_round(&runner, num_threads, first, end);
+        deals += count;
+
+        // merged in set order, so totals do not depend on scheduling
+        for (uint64_t id = first; id < end; id++)
+        {
+            const TournamentSet *set = &runner.results[id - first];
+            const TournamentPair *pair = &pairs[id % sets_per_deal / runner.num_counts];
+            TournamentPairTotals *totals = &pair_totals[id % sets_per_deal / runner.num_counts];
+            if (set->games == 0)
+            {
+                ok = false; // every worker failed to set up
+                break;
+            }
+
+            double diff = set->score_diff_sum / set->games;
+            totals->games += set->games;
+            totals->wins_a += set->wins_a;
+            totals->wins_b += set->wins_b;
+            totals->draws += set->draws;
+            totals->sets++;
+            totals->diff_sum += diff;
+            totals->diff_sq_sum += diff * diff;
+            entrant_totals[pair->a].score += set->score_a;
+            entrant_totals[pair->a].seats += set->seats_a;
+            entrant_totals[pair->a].games += set->games;
+            entrant_totals[pair->b].score += set->score_b;
+            entrant_totals[pair->b].seats += set->seats_b;
+            entrant_totals[pair->b].games += set->games;
+            local.games += set->games;
+            local.steps += set->steps;
+        }
+
+        if (ok && local.significant_after_s < 0.0 && tournament_all_significant(pair_totals, num_pairs, config->z))
+        {
+            local.significant_after_s = tournament_now_s() - start;
+            if (config->stop_when_significant)
+                break;
+        }
+    }
+
+    local.elapsed_s = tournament_now_s() - start;
+    local.deals = deals;
+    local.significant = local.significant_after_s >= 0.0;
+    if (local.elapsed_s > 0.0)
+    {
+        local.games_per_sec = (double)local.games / local.elapsed_s;
+        local.steps_per_sec = (double)local.steps / local.elapsed_s;
+    }
+
+    pthread_mutex_lock(&runner.lock);
+    runner.quit = true;
+    pthread_cond_broadcast(&runner.start_cond);
+    pthread_mutex_unlock(&runner.lock);
+    for (uint32_t t = 0; t < num_threads; t++)
+        pthread_join(workers[t].thread, NULL);
+
+    if (ok)
+    {
+        tournament_report(&runner, pair_totals, entrant_totals, out_ratings, out_pairings);
+        if (stats)
+            *stats = local;
+    }
+
+    pthread_cond_destroy(&runner.done_cond);
+    pthread_cond_destroy(&runner.start_cond);
+    pthread_mutex_destroy(&runner.lock);
+    free(runner.results);
+    free(workers);
+    free(entrant_totals);
+    free(pair_totals);
+    free(pairs);
+    return ok;
+}
@@ -0,0 +1,133 @@
+#include "poison_tt.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define TT_BUCKET_ENTRIES 4
+#define TT_ALIGNMENT 64
+
+// each entry stores key ^ data next to data, so a reader racing a writer sees
+// a mismatching key instead of a torn entry (Hyatt's lockless hashing)
+typedef struct
+{
+    _Atomic uint64_t check;
+    _Atomic uint64_t data;
+} TTEntry;
+
+typedef struct
+{
+    TTEntry entries[TT_BUCKET_ENTRIES];
+} TTBucket;
+
+_Static_assert(sizeof(TTBucket) == TT_ALIGNMENT, "a bucket should fill one cache line");
+
+struct TranspositionTable
+{
+    TTBucket *buckets;
+    size_t bucket_mask;
+};
+
+TranspositionTable *tt_create(size_t num_entries)
+{
+    size_t num_buckets = 1;
+    while (num_buckets * TT_BUCKET_ENTRIES < num_entries)
+    {
+        if (num_buckets > SIZE_MAX / (2 * sizeof(TTBucket)))
+            return NULL;
+        num_buckets *= 2;
+    }
+
+    TranspositionTable *tt = malloc(sizeof(*tt));
+    if (!tt)
+        return NULL;
+
+    tt->buckets = aligned_alloc(TT_ALIGNMENT, num_buckets * sizeof(TTBucket));
+    if (!tt->buckets)
+    {
+        free(tt);
+        return NULL;
+    }
+
+    tt->bucket_mask = num_buckets - 1;
+    tt_clear(tt);
+    return tt;
+}
+
+void tt_destroy(TranspositionTable *tt)
+{
+    if (tt)
+    {
+        free(tt->buckets);
+        free(tt);
+    }
+}
+
+void tt_clear(TranspositionTable *tt)
+{
+    if (!tt)
+        return;
+
+    for (size_t b = 0; b <= tt->bucket_mask; b++)
+    {
+        for (int i = 0; i < TT_BUCKET_ENTRIES; i++)
+        {
+            atomic_init(&tt->buckets[b].entries[i].check, 0);
+            atomic_init(&tt->buckets[b].entries[i].data, 0);
+        }
+    }
+}
+
+size_t tt_capacity(const TranspositionTable *tt)
+{
+    return tt ? (tt->bucket_mask + 1) * TT_BUCKET_ENTRIES : 0;
+}
+
+static TTBucket *tt_bucket(const TranspositionTable *tt, uint64_t key)
+{
+    return &tt->buckets[key & tt->bucket_mask];
+}
+
+bool tt_probe(const TranspositionTable *tt, uint64_t key, uint64_t *out_data)
+{
+    if (!tt || !out_data)
+        return false;
+
+    TTBucket *bucket = tt_bucket(tt, key);
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++)
+    {
+        uint64_t data = atomic_load_explicit(&bucket->entries[i].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&bucket->entries[i].check, memory_order_relaxed);
+        if ((check ^ data) == key && (check | data) != 0)
+        {
+            *out_data = data;
+            return true;
+        }
+    }
+    return false;
+}
+
+void tt_store(TranspositionTable *tt, uint64_t key, uint64_t data)
+{
+    if (!tt)
+        return;
+
+    TTBucket *bucket = tt_bucket(tt, key);
+    int slot = -1;
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++)
+    {
+        uint64_t old_data = atomic_load_explicit(&bucket->entries[i].data, memory_order_relaxed);
+        uint64_t old_check = atomic_load_explicit(&bucket->entries[i].check, memory_order_relaxed);
+        if ((old_check ^ old_data) == key || (old_check | old_data) == 0)
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    // bucket full: evict by high key bits, which the bucket index does not use
+    if (slot < 0)
+        slot = (int)(key >> 62) & (TT_BUCKET_ENTRIES - 1);
+
+    atomic_store_explicit(&bucket->entries[slot].data, data, memory_order_relaxed);
+    atomic_store_explicit(&bucket->entries[slot].check, key ^ data, memory_order_relaxed);
+}
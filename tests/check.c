@@ -0,0 +1,304 @@
+// consistency checks run by `make check`. The engine source is included
+// directly so the static game_compute_hash can be compared against the
+// incrementally maintained hash.
+
+#include "poison.c"
+
+#include "poison_replay.h"
+
+#include <stdio.h>
+
+#define CHECK_SEEDS 40
+#define CHECK_REPLAY_PATH "poison_check.rpl"
+
+static unsigned check_failures;
+
+static void check_fail(const char *what, uint8_t num_players, GameVariant variant, uint64_t seed)
+{
+    if (check_failures++ < 10)
+        fprintf(stderr, "check: %s (%u players, variant %d, seed %llu)\n", what, num_players, (int)variant,
+                (unsigned long long)seed);
+}
+
+static bool players_equal(const Player *a, const Player *b)
+{
+    return a->hand_size == b->hand_size && a->collected_size == b->collected_size && a->score == b->score &&
+           memcmp(a->hand, b->hand, a->hand_size) == 0 &&
+           memcmp(a->hand_counts, b->hand_counts, sizeof(a->hand_counts)) == 0 &&
+           memcmp(a->collected_counts, b->collected_counts, sizeof(a->collected_counts)) == 0;
+}
+
+static bool cauldrons_equal(const Cauldron *a, const Cauldron *b)
+{
+    return a->num_cards == b->num_cards && a->total_value == b->total_value && a->color == b->color &&
+           memcmp(a->cards, b->cards, a->num_cards) == 0 && memcmp(a->counts, b->counts, sizeof(a->counts)) == 0;
+}
+
+static bool states_equal(const GameState *a, const GameState *b)
+{
+    if (a->num_players != b->num_players || a->current_player != b->current_player || a->dealer != b->dealer ||
+        a->round != b->round || a->game_over != b->game_over || a->round_scored != b->round_scored ||
+        a->cards_in_hands != b->cards_in_hands || a->deck_size != b->deck_size || a->deck_pos != b->deck_pos ||
+        a->hash != b->hash || memcmp(a->deck, b->deck, a->deck_size) != 0)
+        return false;
+
+    for (uint8_t p = 0; p < a->num_players; p++)
+    {
+        if (!players_equal(&a->players[p], &b->players[p]) ||
+            memcmp(a->player_features[p], b->player_features[p], sizeof(a->player_features[p])) != 0)
+            return false;
+    }
+    for (uint8_t c = 0; c < NUM_CAULDRONS; c++)
+    {
+        if (!cauldrons_equal(&a->cauldrons[c], &b->cauldrons[c]) ||
+            memcmp(a->cauldron_features[c], b->cauldron_features[c], sizeof(a->cauldron_features[c])) != 0)
+            return false;
+    }
+    return true;
+}
+
+// every step of a game is undone right away and must restore the exact state;
+// the incremental hash must match a full recomputation after every change
+static uint64_t check_undo_and_hash(uint8_t num_players, GameVariant variant, uint64_t seed)
+{
+    GameState *state = game_init(num_players, variant, seed);
+    GameState *before = game_clone(state);
+    GameRng rng;
+    game_rng_seed(&rng, seed, 1);
+    uint64_t checks = 0;
+
+    while (state && before && !state->game_over)
+    {
+        uint16_t action = game_sample_legal_action(state, &rng);
+        game_copy_into(before, state);
+
+        GameUndo undo;
+        game_step_with_undo(state, action, &undo);
+        if (state->hash != game_compute_hash(state))
+            check_fail("hash differs after game_step_with_undo", num_players, variant, seed);
+        game_undo(state, &undo);
+        if (!states_equal(state, before))
+            check_fail("game_undo did not restore the state", num_players, variant, seed);
+
+        StepResult result = game_step_action(state, action);
+        if (result.round_done && !result.done)
+            game_start_new_round(state);
+        if (state->hash != game_compute_hash(state))
+            check_fail("hash differs after game_step_action", num_players, variant, seed);
+        checks++;
+    }
+
+    game_destroy(before);
+    game_destroy(state);
+    return checks;
+}
+
+// every colour relabelling of a position canonicalizes to the same state, and
+// typed moves map to the canonical position and back unchanged
+static uint64_t check_canonical(uint8_t num_players, GameVariant variant, uint64_t seed)
+{
+    GameState *state = game_init(num_players, variant, seed);
+    GameState *canonical = game_clone(state);
+    GameState *relabelled = game_clone(state);
+    GameRng rng;
+    game_rng_seed(&rng, seed, 2);
+    uint64_t checks = 0;
+
+    while (state && canonical && relabelled && !state->game_over)
+    {
+        uint8_t perm = game_canonicalize(state, canonical);
+        if (canonical->hash != game_compute_hash(canonical))
+            check_fail("canonical hash differs from game_compute_hash", num_players, variant, seed);
+
+        for (uint8_t p = 0; p < GAME_NUM_COLOR_PERMS; p++)
+        {
+            game_permute_colors(state, p, relabelled);
+            game_canonicalize(relabelled, relabelled);
+            if (!states_equal(relabelled, canonical))
+                check_fail("relabelled state canonicalizes differently", num_players, variant, seed);
+        }
+
+        uint64_t bits = 0;
+        uint64_t canonical_bits = 0;
+        game_get_typed_legal_action_bits(state, &bits);
+        game_get_typed_legal_action_bits(canonical, &canonical_bits);
+        if (game_permute_typed_action_bits(bits, perm) != canonical_bits)
+            check_fail("typed legal bits do not follow the canonical permutation", num_players, variant, seed);
+        for (uint64_t rest = bits; rest; rest &= rest - 1)
+        {
+            uint16_t typed = (uint16_t)__builtin_ctzll(rest);
+            uint16_t mapped = game_permute_typed_action(typed, perm);
+            if (game_permute_typed_action(mapped, game_color_perm_inverse(perm)) != typed)
+                check_fail("typed action does not map back from the canonical position", num_players, variant,
+                           seed);
+        }
+
+        StepResult result = game_step_action(state, game_sample_legal_action(state, &rng));
+        if (result.round_done && !result.done)
+            game_start_new_round(state);
+        checks++;
+    }
+
+    game_destroy(relabelled);
+    game_destroy(canonical);
+    game_destroy(state);
+    return checks;
+}
+
+// every compact observation format decodes back to the float observation, for
+// both observation modes and every perspective
+static uint64_t check_encodings(uint8_t num_players, GameVariant variant, uint64_t seed)
+{
+    static const GameObsFormat formats[] = {GAME_OBS_FORMAT_U8, GAME_OBS_FORMAT_I8, GAME_OBS_FORMAT_BITS};
+    GameState *state = game_init(num_players, variant, seed);
+    GameRng rng;
+    game_rng_seed(&rng, seed, 3);
+    float expected[OBS_SIZE];
+    float decoded[OBS_SIZE];
+    uint8_t encoded[OBS_SIZE * sizeof(float)];
+    uint64_t checks = 0;
+
+    while (state && !state->game_over)
+    {
+        for (int mode = GAME_OBS_FULL; mode <= GAME_OBS_PARTIAL; mode++)
+        {
+            for (uint8_t p = 0; p < num_players; p++)
+            {
+                game_get_observation(state, p, (GameObsMode)mode, expected, OBS_SIZE);
+                for (uint8_t q = 0; q < num_players; q++)
+                {
+                    // I8 keeps scores signed; anything at INT8_MIN may have been clamped
+                    if (expected[OBS_HEADER_FEATURES + q * OBS_PLAYER_FEATURES + FEAT_SCORE] <= INT8_MIN)
+                        check_fail("score reaches the I8 observation limit", num_players, variant, seed);
+                }
+                for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+                {
+                    game_get_observation_encoded(state, p, (GameObsMode)mode, formats[f], encoded, sizeof(encoded));
+                    game_decode_observation(encoded, formats[f], decoded, OBS_SIZE);
+                    if (memcmp(decoded, expected, sizeof(expected)) != 0)
+                        check_fail("encoded observation does not decode to the float observation", num_players,
+                                   variant, seed);
+                }
+            }
+        }
+
+        StepResult result = game_step_action(state, game_sample_legal_action(state, &rng));
+        if (result.round_done && !result.done)
+            game_start_new_round(state);
+        checks++;
+    }
+
+    game_destroy(state);
+    return checks;
+}
+
+// records random games, then re-simulates them from the file and compares
+// every action, reward and final score
+static uint64_t check_replay(void)
+{
+    enum
+    {
+        GAMES = 2 * (NUM_PLAYERS_MAX - NUM_PLAYERS_MIN + 1),
+        MAX_STEPS = 1024
+    };
+    static uint16_t actions[GAMES][MAX_STEPS];
+    static float rewards[GAMES][MAX_STEPS];
+    uint32_t num_steps[GAMES];
+    int32_t scores[GAMES][NUM_PLAYERS_MAX];
+
+    ReplayWriter *writer = replay_writer_open(CHECK_REPLAY_PATH, REPLAY_RECORD_REWARDS, GAME_OBS_PARTIAL);
+    if (!writer)
+    {
+        check_fail("cannot open " CHECK_REPLAY_PATH, 0, GAME_VARIANT_CLASSIC, 0);
+        return 0;
+    }
+
+    GameRng rng;
+    game_rng_seed(&rng, 42, 1);
+    for (size_t g = 0; g < GAMES; g++)
+    {
+        uint8_t num_players = (uint8_t)(NUM_PLAYERS_MIN + g / 2);
+        GameVariant variant = (GameVariant)(g % 2);
+        GameState *state = game_init(num_players, variant, g);
+        replay_writer_begin_game(writer, state, g);
+
+        num_steps[g] = 0;
+        while (!state->game_over && num_steps[g] < MAX_STEPS)
+        {
+            uint16_t action = game_sample_legal_action(state, &rng);
+            actions[g][num_steps[g]] = action;
+            rewards[g][num_steps[g]] = replay_writer_step(writer, state, action).reward;
+            num_steps[g]++;
+        }
+        for (uint8_t p = 0; p < num_players; p++)
+            scores[g][p] = state->players[p].score;
+
+        replay_writer_end_game(writer);
+        game_destroy(state);
+    }
+    replay_writer_close(writer);
+
+    uint64_t checks = 0;
+    ReplayReader *reader = replay_reader_open(CHECK_REPLAY_PATH);
+    GameState *state = game_init(NUM_PLAYERS_MIN, GAME_VARIANT_CLASSIC, 0);
+    if (!reader || !state || replay_reader_num_games(reader) != GAMES)
+        check_fail("replay file does not hold every recorded game", 0, GAME_VARIANT_CLASSIC, 0);
+
+    for (size_t g = 0; reader && state && g < replay_reader_num_games(reader) && g < GAMES; g++)
+    {
+        ReplayCursor cursor;
+        ReplayStep step;
+        uint32_t n = 0;
+        replay_cursor_init(&cursor, reader, g, state);
+        while (replay_cursor_next(&cursor, &step, NULL, 0, NULL, 0))
+        {
+            if (n >= num_steps[g] || step.action_id != actions[g][n] || step.reward != rewards[g][n])
+                check_fail("replayed step differs", state->num_players, state->variant, g);
+            n++;
+        }
+        if (n != num_steps[g] || !state->game_over)
+            check_fail("replay ended early", state->num_players, state->variant, g);
+        for (uint8_t p = 0; p < state->num_players; p++)
+        {
+            if (state->players[p].score != scores[g][p])
+                check_fail("replayed final score differs", state->num_players, state->variant, g);
+        }
+        checks += n;
+    }
+
+    game_destroy(state);
+    replay_reader_close(reader);
+    remove(CHECK_REPLAY_PATH);
+    return checks;
+}
+
+int main(void)
+{
+    uint64_t steps = 0;
+    uint64_t canonical_steps = 0;
+    uint64_t encoding_steps = 0;
+    for (uint8_t np = NUM_PLAYERS_MIN; np <= NUM_PLAYERS_MAX; np++)
+    {
+        for (int variant = GAME_VARIANT_CLASSIC; variant <= GAME_VARIANT_DRAW; variant++)
+        {
+            for (uint64_t seed = 1; seed <= CHECK_SEEDS; seed++)
+            {
+                steps += check_undo_and_hash(np, (GameVariant)variant, seed);
+                canonical_steps += check_canonical(np, (GameVariant)variant, seed);
+                encoding_steps += check_encodings(np, (GameVariant)variant, seed);
+            }
+        }
+    }
+    printf("undo and hash: %llu steps\n", (unsigned long long)steps);
+    printf("canonicalization: %llu positions\n", (unsigned long long)canonical_steps);
+    printf("observation encodings: %llu positions\n", (unsigned long long)encoding_steps);
+    printf("replay: %llu steps\n", (unsigned long long)check_replay());
+
+    if (check_failures)
+    {
+        fprintf(stderr, "check: %u failures\n", check_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}